@@ -25,8 +25,180 @@
 #include "decompress.h"
 #include "assert.h"
 #include "compress40.h"
+#include "stream.h"
+#include "parallel.h"
+#include "fixed.h"
+#include "scratch.h"
+#include "codec.h"
+#include "batch.h"
+#include "crop.h"
+#include "thumb.h"
+#include "container.h"
+#include "stats.h"
 
 static void (*compress_or_decompress)(FILE *input) = compress40;
+static unsigned nthreads = 1;
+static struct crop region;
+static unsigned scale;
+static unsigned format = 2;
+static coding strip_coding = CODING_RAW;
+
+/********** compress40_threads ********
+ *
+ * Runs the parallel compressor with the thread count given by -j
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding a PPM image
+ ************************/
+static void compress40_threads(FILE *fp)
+{
+        compress40_parallel(fp, nthreads);
+}
+
+/********** decompress40_threads ********
+ *
+ * Runs the parallel decompressor with the thread count given by -j
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a CS40 compressed format file
+ ************************/
+static void decompress40_threads(FILE *fp)
+{
+        decompress40_parallel(fp, nthreads);
+}
+
+/********** compress40_frames ********
+ *
+ * Compresses every PPM image in a file, one after another, with one codec
+ * context for as long as the images stay the same size
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding one or more PPM images
+ *
+ * Notes:
+ *      Writes the compressed images to stdout, one after another
+ ************************/
+static void compress40_frames(FILE *fp)
+{
+        ppm_reader reader = ppm_reader_new(fp);
+        codec c = NULL;
+
+        do {
+                if (c != NULL && !codec_fits(c, reader->width,
+                                             reader->height)) {
+                        codec_free(&c);
+                }
+                if (c == NULL) {
+                        c = codec_new(reader->width, reader->height,
+                                      nthreads);
+                }
+                codec_compress(c, reader, stdout);
+        } while (ppm_reader_next(reader));
+
+        codec_free(&c);
+        ppm_reader_free(&reader);
+}
+
+/********** decompress40_frames ********
+ *
+ * Decompresses every CS40 compressed image in a file, one after another,
+ * with one codec context for as long as the images stay the same size
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding one or more compressed images
+ *
+ * Notes:
+ *      Writes the PPM images to stdout, one after another
+ *      Format 3 images are decompressed by container_decompress, each
+ *      with its own buffers
+ ************************/
+static void decompress40_frames(FILE *fp)
+{
+        struct comp40_header header;
+        codec c = NULL;
+
+        while (container_read_header(fp, &header)) {
+                if (header.version == 3) {
+                        if (!container_decompress(fp, &header, nthreads,
+                                                  stdout)) {
+                                exit(1);
+                        }
+                        continue;
+                }
+                if (c != NULL && !codec_fits(c, header.width,
+                                             header.height)) {
+                        codec_free(&c);
+                }
+                if (c == NULL) {
+                        c = codec_new(header.width, header.height,
+                                      nthreads);
+                }
+                codec_decompress(c, fp, stdout);
+        }
+
+        if (c != NULL) {
+                codec_free(&c);
+        }
+}
+
+/********** decompress40_region ********
+ *
+ * Runs the region of interest decompressor on the rectangle given by
+ * --crop
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a CS40 compressed format file
+ ************************/
+static void decompress40_region(FILE *fp)
+{
+        decompress40_crop(fp, region);
+}
+
+/********** decompress40_scaled ********
+ *
+ * Runs the thumbnail decompressor at the scale given by --scale
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a CS40 compressed format file
+ ************************/
+static void decompress40_scaled(FILE *fp)
+{
+        decompress40_thumb(fp, scale);
+}
+
+/********** compress40_format3 ********
+ *
+ * Compresses to format 3, with the coding given by --coding and the
+ * thread count given by -j
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding a PPM image
+ ************************/
+static void compress40_format3(FILE *fp)
+{
+        compress40_container(fp, strip_coding, nthreads);
+}
+
+/********** report_stats ********
+ *
+ * Reports on stderr the time spent in each stage, what was read, written
+ * and handled, the heap allocations made, and how much memory was taken
+ * from scratch allocators
+ *
+ * Notes:
+ *      The heap allocations are the scratches' chunks and every other
+ *      malloc of the codec's own, as counted by stats_allocation; the
+ *      scratch allocations are carved out of those chunks
+ ************************/
+static void report_stats(void)
+{
+        stats_report(stderr);
+        struct scratch_stats totals;
+        scratch_totals(&totals);
+        fprintf(stderr, "stats: %lu scratch allocations, %zu bytes, "
+                "from %lu scratches\n", totals.allocations, totals.bytes,
+                totals.scratches);
+}
 
 /********** main ********
  *
@@ -42,30 +214,200 @@ static void (*compress_or_decompress)(FILE *input) = compress40;
  * Expects:
  *      Inputs that follow expected usage
  * 
+ * Notes:
+ *      -s selects the streaming compressor or decompressor, which give
+ *      the same output as compress40 and decompress40 while holding only
+ *      two rows of the image at a time
+ *      -j N compresses or decompresses on N threads, again with the same
+ *      output
+ *      -f does the arithmetic in integer fixed point, which may change
+ *      the output by a rounding step; it implies -s unless -j is given
+ *      -m compresses or decompresses every image in the input, written
+ *      one after another, reusing one codec context and its threads
+ *      --stats reports on stderr the wall time of each stage and the CPU
+ *      time its work took on every thread that ran it, the wall and CPU
+ *      time of the whole process, pixels and code words handled with
+ *      MP/s, bytes read and written, peak RSS, the heap allocations
+ *      made, and how much memory was taken from scratch allocators,
+ *      which is the same handful of allocations for any size of image
+ *      -o directory selects batch mode: every file named after it, or in
+ *      a directory named after it, is done in this one process, -j N of
+ *      them at once with their codecs kept under --budget megabytes, and
+ *      written to the directory in the format given by --format and
+ *      --coding; throughput is reported on stderr, and a file that is not
+ *      a whole image fails alone, leaving no output
+ *      --crop x,y,w,h decompresses only the w by h rectangle whose upper
+ *      left pixel is at column x, row y, reading only its code words; a
+ *      rectangle reaching past the image is trimmed to it, and one with
+ *      no pixel inside it is an error
+ *      --scale 1/2, 1/4 or 1/8 decompresses a thumbnail straight from the
+ *      code words, one pixel per 1, 2x2 or 4x4 of them
+ *      --format 3 compresses to format 3, which adds an index of strips
+ *      with a CRC-32C for each; -d reads either format, with or without
+ *      -m, --crop and --scale
+ *      --coding rans implies --format 3 and entropy codes each strip,
+ *      which makes smooth images markedly smaller; --coding raw, the
+ *      default, stores the code words as they are
  ************************/
 int main(int argc, char *argv[])
 {
         int i;
+        bool streaming = false;
+        bool frames = false;
+        bool stats = false;
+        const char *outdir = NULL;
+        size_t budget = BATCH_DEFAULT_BUDGET;
+        bool cropping = false;
 
         for (i = 1; i < argc; i++) {
                 if (strcmp(argv[i], "-c") == 0) {
                         compress_or_decompress = compress40;
                 } else if (strcmp(argv[i], "-d") == 0) {
                         compress_or_decompress = decompress40;
+                } else if (strcmp(argv[i], "-s") == 0) {
+                        streaming = true;
+                } else if (strcmp(argv[i], "-m") == 0) {
+                        frames = true;
+                } else if (strcmp(argv[i], "--stats") == 0) {
+                        stats = true;
+                        stats_enable();
+                } else if (strcmp(argv[i], "-f") == 0) {
+                        fixed_point_select(true);
+                        streaming = true;
+                } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        int n = atoi(argv[++i]);
+                        if (n <= 0) {
+                                fprintf(stderr, "%s: bad thread count '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        nthreads = n;
+                } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                        outdir = argv[++i];
+                } else if (strcmp(argv[i], "--budget") == 0 &&
+                           i + 1 < argc) {
+                        long mb = atol(argv[++i]);
+                        if (mb <= 0) {
+                                fprintf(stderr, "%s: bad budget '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        budget = (size_t)mb << 20;
+                } else if (strcmp(argv[i], "--crop") == 0 &&
+                           i + 1 < argc) {
+                        char extra;
+                        if (strchr(argv[++i], '-') != NULL ||
+                            sscanf(argv[i], "%u,%u,%u,%u%c", &region.x,
+                                   &region.y, &region.width,
+                                   &region.height, &extra) != 4) {
+                                fprintf(stderr, "%s: bad region '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        cropping = true;
+                } else if (strcmp(argv[i], "--scale") == 0 &&
+                           i + 1 < argc) {
+                        i++;
+                        if (strcmp(argv[i], "1/2") == 0) {
+                                scale = 2;
+                        } else if (strcmp(argv[i], "1/4") == 0) {
+                                scale = 4;
+                        } else if (strcmp(argv[i], "1/8") == 0) {
+                                scale = 8;
+                        } else {
+                                fprintf(stderr, "%s: bad scale '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                } else if (strcmp(argv[i], "--format") == 0 &&
+                           i + 1 < argc) {
+                        format = atoi(argv[++i]);
+                        if (format != 2 && format != 3) {
+                                fprintf(stderr, "%s: bad format '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                } else if (strcmp(argv[i], "--coding") == 0 &&
+                           i + 1 < argc) {
+                        i++;
+                        if (strcmp(argv[i], "raw") == 0) {
+                                strip_coding = CODING_RAW;
+                        } else if (strcmp(argv[i], "rans") == 0) {
+                                strip_coding = CODING_RANS;
+                        } else {
+                                fprintf(stderr, "%s: bad coding '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        format = 3;
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n",
                                 argv[0], argv[i]);
                         exit(1);
-                } else if (argc - i > 2) {
-                        fprintf(stderr, "Usage: %s -d [filename]\n"
-                                "       %s -c [filename]\n",
+                } else if (outdir == NULL && argc - i > 2) {
+                        fprintf(stderr, "Usage: %s -d [-s | -m] [-f] "
+                                "[-j threads] [--stats] [filename]\n"
+                                "       %s -c [-s | -m] [-f] "
+                                "[-j threads] [--stats] [filename]\n"
+                                "       %s -c | -d [-f] [-j threads] "
+                                "[--budget MB] [--format 2 | 3] "
+                                "[--coding raw | rans] [--stats] "
+                                "-o directory file-or-directory...\n"
+                                "       %s -d --crop x,y,w,h [-f] "
+                                "[--stats] [filename]\n"
+                                "       %s -d --scale 1/2 | 1/4 | 1/8 "
+                                "[--stats] [filename]\n"
+                                "       %s -c --format 3 [--coding raw | rans] "
+                                "[-f] [-j threads] [--stats] [filename]\n",
+                                argv[0], argv[0], argv[0], argv[0],
                                 argv[0], argv[0]);
                         exit(1);
                 } else {
                         break;
                 }
         }
+        if (outdir != NULL) {
+                assert(i < argc);    /* at least one input in batch mode */
+                unsigned failed = batch_run(argv + i, argc - i, outdir,
+                                            compress_or_decompress ==
+                                                    compress40,
+                                            format, strip_coding,
+                                            nthreads, budget);
+                if (stats) {
+                        report_stats();
+                }
+                return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
         assert(argc - i <= 1);    /* at most one file on command line */
+        if (cropping || scale != 0) {
+                if (compress_or_decompress != decompress40 ||
+                    (cropping && scale != 0)) {
+                        fprintf(stderr, "%s: --crop or --scale needs -d, "
+                                "and not both\n", argv[0]);
+                        exit(1);
+                }
+                compress_or_decompress = cropping ? decompress40_region
+                                                  : decompress40_scaled;
+        } else if (format == 3 && compress_or_decompress == compress40) {
+                if (frames) {
+                        fprintf(stderr, "%s: --format 3 does not take "
+                                "-m\n", argv[0]);
+                        exit(1);
+                }
+                compress_or_decompress = compress40_format3;
+        } else if (frames) {
+                compress_or_decompress = 
+                        compress_or_decompress == compress40 ? 
+                                compress40_frames : decompress40_frames;
+        } else if (nthreads > 1) {
+                compress_or_decompress = 
+                        compress_or_decompress == compress40 ? 
+                                compress40_threads : decompress40_threads;
+        } else if (streaming) {
+                compress_or_decompress = 
+                        compress_or_decompress == compress40 ? 
+                                compress40_stream : decompress40_stream;
+        }
         if (i < argc) {
                 FILE *fp = fopen(argv[i], "r");
                 assert(fp != NULL);
@@ -74,6 +416,9 @@ int main(int argc, char *argv[])
         } else {
                 compress_or_decompress(stdin);
         }
+        if (stats) {
+                report_stats();
+        }
 
         return EXIT_SUCCESS; 
 }
@@ -89,29 +434,32 @@ int main(int argc, char *argv[])
  *     The file to hold a properly formatted PPM image
  * 
  * Notes:
- *      Calls compress.c functions that allocated and free memory
+ *      Every array is allocated from one scratch, freed at the end
  *      Writes compressed image to stdout
  ************************/
 void compress40(FILE *fp)
 {
-        A2Methods_T plain_methods = uarray2_methods_plain;
-        A2Methods_T blocked_methods = uarray2_methods_blocked;
-
-        Pnm_ppm image = read_n_trim(fp);
-        UArray2b_T compressed_image = rgb_to_comp_vid(image);
-        UArray2_T word_info_arr = init_word_info_arr(compressed_image);
-        populate_word_info(compressed_image, word_info_arr);
-        finalize_word_info(word_info_arr);
-
-        printf("COMP40 Compressed image format 2\n%u %u\n", image->width,
-                                                          image->height);
-        pack_n_print(word_info_arr);
-
-        A2Methods_UArray2 A2compressed_image = compressed_image;
-        A2Methods_UArray2 A2word_info_arr = word_info_arr;
-        blocked_methods->free(&A2compressed_image);
-        plain_methods->free(&A2word_info_arr);
-        Pnm_ppmfree(&image);
+        struct stats_clock clock;
+        stats_start(&clock);
+        scratch s = scratch_new();
+
+        meth_bundle image = read_n_trim(fp, s);
+        stats_lap(STATS_READ, &clock);
+        UArray2b_T compressed_image = rgb_to_comp_vid(image, s);
+        stats_lap(STATS_COLOR, &clock);
+        UArray2_T word_arr = init_word_arr(compressed_image, s);
+        populate_words(compressed_image, word_arr);
+        stats_lap(STATS_CODE, &clock);
+
+        unsigned width = image->methods->width(image->array);
+        unsigned height = image->methods->height(image->array);
+        printf("COMP40 Compressed image format 2\n%u %u\n", width, height);
+        print_words(word_arr, s);
+        stats_lap(STATS_WRITE, &clock);
+        stats_count(STATS_PIXELS, (uint64_t)width * height);
+        stats_count(STATS_CODEWORDS, (uint64_t)width * height / 4);
+
+        scratch_free(&s);
 }
 
 /********** decompress40 ********
@@ -122,41 +470,41 @@ void compress40(FILE *fp)
  *      FILE *fp: pointer to a CS40 compressed format
  * 
  * Expects:
- *     The file to hold a properly formatted compressed image file
+ *     The file to hold a properly formatted compressed image file, in
+ *     format 2 or format 3
  * 
  * Notes:
- *      Calls decompress.c functions that allocated and free memory
+ *      Every array is allocated from one scratch, freed at the end
  *      Writes decompressed image to stdout
  ************************/
 void decompress40(FILE *fp)
 {
-        A2Methods_T plain_methods = uarray2_methods_plain;
-        A2Methods_T blocked_methods = uarray2_methods_blocked;
-
-        unsigned height, width;
-        int read = fscanf(fp, "COMP40 Compressed image format 2\n%u %u", 
-                          &width, &height);
-        assert(read == 2);
-        int c = getc(fp);
-        assert(c == '\n');
-
-        UArray2_T word_info_arr = unpack_n_store(fp, width, height);
-        UArray2b_T decompressed_image = word_info_to_comp_vid(word_info_arr);
-        UArray2b_T final_decomp_image = comp_vid_to_rgb(decompressed_image);
-
-        Pnm_ppm final_image = NEW(final_image);
-        final_image->width = width;
-        final_image->height = height;
-        final_image->denominator = 255;
-        final_image->methods = blocked_methods;
-        final_image->pixels = final_decomp_image;
-
-        Pnm_ppmwrite(stdout, final_image);
-        
-        A2Methods_UArray2 A2word_info_arr = word_info_arr;
-        A2Methods_UArray2 A2decompressed_image = decompressed_image;
-        
-        blocked_methods->free(&A2decompressed_image);
-        plain_methods->free(&A2word_info_arr);
-        Pnm_ppmfree(&final_image);
-}
\ No newline at end of file
+        struct comp40_header header;
+        bool read = container_read_header(fp, &header);
+        assert(read);
+        if (header.version == 3) {
+                if (!container_decompress(fp, &header, 1, stdout)) {
+                        exit(1);
+                }
+                return;
+        }
+        unsigned width = header.width;
+        unsigned height = header.height;
+
+        struct stats_clock clock;
+        stats_start(&clock);
+        scratch s = scratch_new();
+
+        UArray2_T word_arr = read_word_arr(fp, width, height, s);
+        stats_lap(STATS_READ, &clock);
+        UArray2b_T decompressed_image = words_to_comp_vid(word_arr, s);
+        stats_lap(STATS_CODE, &clock);
+        UArray2_T final_image = comp_vid_to_rgb(decompressed_image, s);
+        stats_lap(STATS_COLOR, &clock);
+        write_rgb(stdout, final_image);
+        stats_lap(STATS_WRITE, &clock);
+        stats_count(STATS_PIXELS, (uint64_t)(width & ~1u) * (height & ~1u));
+        stats_count(STATS_CODEWORDS, (uint64_t)(width / 2) * (height / 2));
+
+        scratch_free(&s);
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ *
+ *                                  a2inline.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file is a statically dispatched counterpart to A2Methods_T.
+ *      Going through a2plain.c or a2blocked.c costs an indirect call to
+ *      apply for every element, and usually another to methods->at, which
+ *      keeps the compiler from inlining or vectorizing anything. Here the
+ *      element lookups are static inline functions, and the mapping
+ *      functions are generated by macros for one element type, closure
+ *      type and apply function at a time, so the apply function is called
+ *      directly and can be inlined into the loop.
+ *
+ *      For example,
+ *
+ *              A2_DEFINE_MAP_ROW_MAJOR(map_words, struct word_info,
+ *                                      FILE *, print_word)
+ *
+ *      defines map_words(UArray2_T array2, FILE *cl), which calls
+ *      print_word(col, row, elem, cl) with elem a struct word_info * for
+ *      every element in row major order. The A2Methods_T interfaces are
+ *      still there for code that wants to choose a representation at run
+ *      time; both work on the same arrays.
+ *
+ ******************************************************************************/
+
+#ifndef A2INLINE_INCLUDED
+#define A2INLINE_INCLUDED
+
+#include <stddef.h>
+#include <assert.h>
+#include "uarray2_rep.h"
+#include "uarray2b_rep.h"
+
+/********** UArray2_at_inline ********
+ *
+ * Returns a pointer to element (i, j) of a UArray2_T
+ *
+ * Inputs:
+ *      UArray2_T array2:       the array
+ *      int i, j:               the column and row of the element
+ *
+ * Expects:
+ *      array2 to not be null, (i, j) to be in bounds; unlike UArray2_at
+ *      the bounds are not checked
+ ************************/
+static inline void *UArray2_at_inline(UArray2_T array2, int i, int j)
+{
+        return array2->cells + (size_t)j * array2->stride +
+               (size_t)i * array2->size;
+}
+
+/********** UArray2b_at_inline ********
+ *
+ * Returns a pointer to element (i, j) of a UArray2b_T
+ *
+ * Inputs:
+ *      UArray2b_T array2b:     the array
+ *      int i, j:               the column and row of the element
+ *
+ * Expects:
+ *      array2b to not be null, (i, j) to be in bounds; unlike UArray2b_at
+ *      the bounds are not checked
+ ************************/
+static inline void *UArray2b_at_inline(UArray2b_T array2b, int i, int j)
+{
+        int bx, by, cell;
+        if (array2b->shift >= 0) {
+                int shift = array2b->shift;
+                unsigned mask = array2b->mask;
+                bx = i >> shift;
+                by = j >> shift;
+                cell = ((i & mask) << shift) + (j & mask);
+        } else {
+                int b = array2b->blocksize;
+                bx = i / b;
+                by = j / b;
+                cell = (i % b) * b + j % b;
+        }
+        size_t block = (size_t)bx * array2b->yblocks + by;
+        return array2b->cells + block * array2b->block_bytes
+                              + (size_t)cell * array2b->size;
+}
+
+/*
+ * A2_DEFINE_MAP_ROW_MAJOR(name, type, cl_type, apply) defines
+ *
+ *      static inline void name(UArray2_T array2, cl_type cl)
+ *
+ * which calls apply(int col, int row, type *elem, cl_type cl) for every
+ * element of array2, a row at a time, exactly as map_row_major would
+ */
+#define A2_DEFINE_MAP_ROW_MAJOR(name, type, cl_type, apply)                  \
+static inline void name(UArray2_T array2, cl_type cl)                        \
+{                                                                            \
+        assert(array2);                                                      \
+        assert(array2->size == (int)sizeof(type));                           \
+        int h = array2->height;                                              \
+        int w = array2->width;                                               \
+        for (int row = 0; row < h; row++) {                                  \
+                type *elems = (type *)(array2->cells +                       \
+                                       (size_t)row * array2->stride);        \
+                for (int col = 0; col < w; col++) {                          \
+                        apply(col, row, &elems[col], cl);                    \
+                }                                                            \
+        }                                                                    \
+}
+
+/*
+ * A2_DEFINE_MAP_BLOCK_MAJOR(name, type, cl_type, bsz, apply) defines
+ *
+ *      static inline void name(UArray2b_T array2b, cl_type cl)
+ *
+ * which calls apply(int col, int row, type *elem, cl_type cl) for every
+ * element of array2b in the same order as map_block_major. The blocksize,
+ * bsz, is fixed when the map is defined, so the loop over a block's cells
+ * can be unrolled; the array must have been made with that blocksize.
+ */
+#define A2_DEFINE_MAP_BLOCK_MAJOR(name, type, cl_type, bsz, apply)           \
+static inline void name(UArray2b_T array2b, cl_type cl)                      \
+{                                                                            \
+        assert(array2b);                                                     \
+        assert(array2b->size == sizeof(type));                               \
+        assert(array2b->blocksize == (bsz));                                 \
+        int h = array2b->height;                                             \
+        int w = array2b->width;                                              \
+        type *block = (type *)array2b->cells;                                \
+        for (int bx = 0; bx < array2b->xblocks; bx++) {                      \
+                for (int by = 0; by < array2b->yblocks; by++) {              \
+                        for (int cell = 0; cell < (bsz) * (bsz); cell++) {   \
+                                int col = bx * (bsz) + cell / (bsz);         \
+                                int row = by * (bsz) + cell % (bsz);         \
+                                if (col < w && row < h) {                    \
+                                        apply(col, row, &block[cell], cl);   \
+                                }                                            \
+                        }                                                    \
+                        block += (bsz) * (bsz);                              \
+                }                                                            \
+        }                                                                    \
+}
+
+/*
+ * A2_DEFINE_MAP_BLOCKS(name, type, cl_type, bsz, apply) defines
+ *
+ *      static inline void name(UArray2b_T array2b, cl_type cl)
+ *
+ * which calls apply(int bcol, int brow, type *block, cl_type cl) once for
+ * every block of array2b, in the same order as map_block_major. block
+ * points to the bsz * bsz cells of the block, with cell (i, j) of the
+ * block at block[i * bsz + j]; cells of edge blocks that fall outside the
+ * array are there but unused. This is the inline counterpart of
+ * UArray2b_map_blocks in uarray2b_ext.h.
+ */
+#define A2_DEFINE_MAP_BLOCKS(name, type, cl_type, bsz, apply)                \
+static inline void name(UArray2b_T array2b, cl_type cl)                      \
+{                                                                            \
+        assert(array2b);                                                     \
+        assert(array2b->size == sizeof(type));                               \
+        assert(array2b->blocksize == (bsz));                                 \
+        type *block = (type *)array2b->cells;                                \
+        for (int bx = 0; bx < array2b->xblocks; bx++) {                      \
+                for (int by = 0; by < array2b->yblocks; by++) {              \
+                        apply(bx, by, block, cl);                            \
+                        block += (bsz) * (bsz);                              \
+                }                                                            \
+        }                                                                    \
+}
+
+#endif
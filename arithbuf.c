@@ -0,0 +1,374 @@
+/*******************************************************************************
+ *
+ *                                  arithbuf.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the in-memory compressor and decompressor. They
+ *      run the same block row kernels as the streaming codec, over chunks
+ *      of CHUNK_BLOCKS blocks whose pixels and code words fit on the
+ *      stack, so they need no allocation; every block depends only on its
+ *      own pixels, so chunking does not change a single code word. The
+ *      kernels' tables are built once, through pthread_once, and only read
+ *      afterwards, which makes the functions here safe to call from any
+ *      number of threads.
+ *
+ *      Arguments are checked and reported through arithbuf_status rather
+ *      than asserted, so a bad buffer never takes down the caller.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <pnm.h>
+#include "codeword.h"
+#include "blockrow.h"
+#include "arithbuf.h"
+
+#define MAGIC "COMP40 Compressed image format 2"
+
+/* blocks encoded or decoded at a time */
+#define CHUNK_BLOCKS 64
+
+/* more than enough for the magic, two numbers and the separators */
+#define HEADER_MAX 64
+
+static const char *messages[] = {
+        [ARITHBUF_OK] = "success",
+        [ARITHBUF_BAD_ARGUMENT] = "bad argument",
+        [ARITHBUF_TOO_LARGE] = "image too large",
+        [ARITHBUF_SHORT_BUFFER] = "buffer too small",
+        [ARITHBUF_BAD_FORMAT] = "not a COMP40 compressed image",
+};
+
+/********** arithbuf_message ********
+ *
+ * Describes a status
+ *
+ * Inputs:
+ *      arithbuf_status status: the status
+ *
+ * Return:
+ *      a constant string describing it
+ ************************/
+const char *arithbuf_message(arithbuf_status status)
+{
+        if ((unsigned)status >= sizeof(messages) / sizeof(messages[0])) {
+                return "unknown status";
+        }
+        return messages[status];
+}
+
+/********** write_header ********
+ *
+ * Formats the header of a compressed image, exactly as compress40 prints
+ * it
+ *
+ * Inputs:
+ *      char header[HEADER_MAX]:        receives the header, not terminated
+ *      unsigned width, height:         the size of the full-color image
+ *
+ * Return:
+ *      the length of the header
+ ************************/
+static size_t write_header(char header[HEADER_MAX], unsigned width,
+                           unsigned height)
+{
+        return snprintf(header, HEADER_MAX, MAGIC "\n%u %u\n",
+                        width - width % 2, height - height % 2);
+}
+
+/********** arithbuf_compressed_size ********
+ *
+ * Computes the size of the compressed form of an image
+ *
+ * Inputs:
+ *      unsigned width, height: the size of the full-color image
+ *
+ * Return:
+ *      the number of bytes arithbuf_compress writes for the image, or 0 if
+ *      that does not fit in a size_t
+ ************************/
+size_t arithbuf_compressed_size(unsigned width, unsigned height)
+{
+        char header[HEADER_MAX];
+        size_t header_len = write_header(header, width, height);
+        size_t blocks = (size_t)(width / 2) * (height / 2);
+
+        if (width / 2 != 0 && blocks / (width / 2) != height / 2) {
+                return 0;
+        }
+        if (blocks > (SIZE_MAX - header_len) / 4) {
+                return 0;
+        }
+        return header_len + 4 * blocks;
+}
+
+/********** arithbuf_compress ********
+ *
+ * Compresses an image held in memory
+ *
+ * Inputs:
+ *      const unsigned char *pixels:    the image, 3 bytes per pixel in the
+ *                                      order red, green, blue, with a
+ *                                      denominator of 255
+ *      size_t stride:                  bytes from one row to the next
+ *      unsigned width, height:         the size of the image
+ *      unsigned char *out:             receives the compressed image
+ *      size_t out_size:                the size of out
+ *      size_t *written:                receives the number of bytes
+ *                                      written, arithbuf_compressed_size
+ *
+ * Return:
+ *      ARITHBUF_OK, or the reason nothing was written
+ *
+ * Notes:
+ *      An odd last row or column is trimmed, as in compress40
+ *      out holds exactly what compress40 writes for the same image
+ ************************/
+arithbuf_status arithbuf_compress(const unsigned char *pixels, size_t stride,
+                                  unsigned width, unsigned height,
+                                  unsigned char *out, size_t out_size,
+                                  size_t *written)
+{
+        if (pixels == NULL || out == NULL || written == NULL ||
+            stride / 3 < width) {
+                return ARITHBUF_BAD_ARGUMENT;
+        }
+        size_t size = arithbuf_compressed_size(width, height);
+        if (size == 0) {
+                return ARITHBUF_TOO_LARGE;
+        }
+        if (out_size < size) {
+                return ARITHBUF_SHORT_BUFFER;
+        }
+
+        char header[HEADER_MAX];
+        size_t header_len = write_header(header, width, height);
+        memcpy(out, header, header_len);
+        unsigned char *bytes = out + header_len;
+
+        unsigned width_in_blocks = width / 2;
+        struct rgb16 top[2 * CHUNK_BLOCKS], bottom[2 * CHUNK_BLOCKS];
+        uint32_t words[CHUNK_BLOCKS];
+
+        for (unsigned row = 0; row < height / 2; row++) {
+                const unsigned char *rows[2] = {
+                        pixels + 2 * row * stride,
+                        pixels + (2 * row + 1) * stride
+                };
+                for (unsigned start = 0; start < width_in_blocks;
+                     start += CHUNK_BLOCKS) {
+                        unsigned left = width_in_blocks - start;
+                        unsigned count = left < CHUNK_BLOCKS ? left
+                                                             : CHUNK_BLOCKS;
+                        for (unsigned i = 0; i < 2 * count; i++) {
+                                const unsigned char *t = rows[0] +
+                                                         3 * (2 * start + i);
+                                const unsigned char *b = rows[1] +
+                                                         3 * (2 * start + i);
+                                top[i] = (struct rgb16){ t[0], t[1], t[2] };
+                                bottom[i] = (struct rgb16){ b[0], b[1],
+                                                            b[2] };
+                        }
+                        encode_block_row(top, bottom, count, 255, words);
+                        codewords_to_bytes(words, count, bytes);
+                        bytes += 4 * count;
+                }
+        }
+
+        *written = size;
+        return ARITHBUF_OK;
+}
+
+/********** read_number ********
+ *
+ * Reads an unsigned decimal number from a header, as %u does in fscanf
+ *
+ * Inputs:
+ *      const unsigned char **p:        the next byte, advanced past the
+ *                                      number
+ *      const unsigned char *end:       the end of the buffer
+ *      unsigned *n:                    receives the number
+ *
+ * Return:
+ *      false if there is no number or it does not fit in an unsigned
+ ************************/
+static bool read_number(const unsigned char **p, const unsigned char *end,
+                        unsigned *n)
+{
+        while (*p < end && isspace(**p)) {
+                (*p)++;
+        }
+        if (*p == end || !isdigit(**p)) {
+                return false;
+        }
+        unsigned long long value = 0;
+        while (*p < end && isdigit(**p)) {
+                value = value * 10 + (**p - '0');
+                if (value > UINT32_MAX) {
+                        return false;
+                }
+                (*p)++;
+        }
+        *n = value;
+        return true;
+}
+
+/********** read_header ********
+ *
+ * Reads the header of a compressed image held in memory
+ *
+ * Inputs:
+ *      const unsigned char *in:        the compressed image
+ *      size_t in_size:                 the number of bytes in it
+ *      unsigned *width, *height:       receive the size in the header
+ *      size_t *header_len:             receives the length of the header
+ *
+ * Return:
+ *      ARITHBUF_OK, or ARITHBUF_BAD_FORMAT
+ *
+ * Notes:
+ *      Accepts what decompress40's fscanf accepts
+ ************************/
+static arithbuf_status read_header(const unsigned char *in, size_t in_size,
+                                   unsigned *width, unsigned *height,
+                                   size_t *header_len)
+{
+        const unsigned char *p = in;
+        const unsigned char *end = in + in_size;
+        size_t magic_len = strlen(MAGIC);
+
+        if (in_size < magic_len || memcmp(in, MAGIC, magic_len) != 0) {
+                return ARITHBUF_BAD_FORMAT;
+        }
+        p += magic_len;
+        if (!read_number(&p, end, width) || !read_number(&p, end, height)) {
+                return ARITHBUF_BAD_FORMAT;
+        }
+        if (p == end || *p != '\n') {
+                return ARITHBUF_BAD_FORMAT;
+        }
+        *header_len = p + 1 - in;
+        return ARITHBUF_OK;
+}
+
+/********** arithbuf_dimensions ********
+ *
+ * Finds the size of the image a compressed image decompresses to
+ *
+ * Inputs:
+ *      const unsigned char *in:        the compressed image
+ *      size_t in_size:                 the number of bytes in it
+ *      unsigned *width, *height:       receive the size
+ *
+ * Return:
+ *      ARITHBUF_OK, or the reason the size could not be found
+ *
+ * Notes:
+ *      width and height are left untouched unless the status is
+ *      ARITHBUF_OK
+ ************************/
+arithbuf_status arithbuf_dimensions(const unsigned char *in, size_t in_size,
+                                    unsigned *width, unsigned *height)
+{
+        if (in == NULL || width == NULL || height == NULL) {
+                return ARITHBUF_BAD_ARGUMENT;
+        }
+        unsigned w, h;
+        size_t header_len;
+        arithbuf_status status = read_header(in, in_size, &w, &h,
+                                             &header_len);
+        if (status == ARITHBUF_OK) {
+                *width = w - w % 2;
+                *height = h - h % 2;
+        }
+        return status;
+}
+
+/********** arithbuf_decompress ********
+ *
+ * Decompresses a compressed image held in memory
+ *
+ * Inputs:
+ *      const unsigned char *in:        the compressed image
+ *      size_t in_size:                 the number of bytes in it
+ *      unsigned char *pixels:          receives the image, 3 bytes per
+ *                                      pixel as in arithbuf_compress
+ *      size_t stride:                  bytes from one row to the next
+ *      size_t pixels_size:             the size of pixels
+ *
+ * Return:
+ *      ARITHBUF_OK, or the reason the image could not be decompressed
+ *
+ * Notes:
+ *      The image has the size arithbuf_dimensions gives; pixels must hold
+ *      stride bytes for every row but the last, and 3 bytes for every
+ *      pixel of the last
+ *      The pixels are exactly those decompress40 writes
+ ************************/
+arithbuf_status arithbuf_decompress(const unsigned char *in, size_t in_size,
+                                    unsigned char *pixels, size_t stride,
+                                    size_t pixels_size)
+{
+        if (in == NULL || pixels == NULL) {
+                return ARITHBUF_BAD_ARGUMENT;
+        }
+        unsigned width, height;
+        size_t header_len;
+        arithbuf_status status = read_header(in, in_size, &width, &height,
+                                             &header_len);
+        if (status != ARITHBUF_OK) {
+                return status;
+        }
+
+        unsigned width_in_blocks = width / 2;
+        unsigned height_in_blocks = height / 2;
+        if (stride / 6 < width_in_blocks) {
+                return ARITHBUF_BAD_ARGUMENT;
+        }
+        size_t blocks = (size_t)width_in_blocks * height_in_blocks;
+        if (width_in_blocks != 0 && blocks / width_in_blocks !=
+                                    height_in_blocks) {
+                return ARITHBUF_TOO_LARGE;
+        }
+        if ((in_size - header_len) / 4 < blocks) {
+                return ARITHBUF_SHORT_BUFFER;
+        }
+        if (height_in_blocks > 0) {
+                size_t last_row = 2 * (size_t)height_in_blocks - 1;
+                if (last_row > (SIZE_MAX - 6 * (size_t)width_in_blocks) /
+                               (stride > 0 ? stride : 1)) {
+                        return ARITHBUF_TOO_LARGE;
+                }
+                if (pixels_size < last_row * stride +
+                                  6 * (size_t)width_in_blocks) {
+                        return ARITHBUF_SHORT_BUFFER;
+                }
+        }
+
+        const unsigned char *bytes = in + header_len;
+        uint32_t words[CHUNK_BLOCKS];
+
+        for (unsigned row = 0; row < height_in_blocks; row++) {
+                unsigned char *top = pixels + 2 * row * stride;
+                unsigned char *bottom = top + stride;
+                for (unsigned start = 0; start < width_in_blocks;
+                     start += CHUNK_BLOCKS) {
+                        unsigned left = width_in_blocks - start;
+                        unsigned count = left < CHUNK_BLOCKS ? left
+                                                             : CHUNK_BLOCKS;
+                        codewords_from_bytes(bytes, count, words);
+                        decode_block_row(words, count, top + 6 * start,
+                                         bottom + 6 * start);
+                        bytes += 4 * count;
+                }
+        }
+
+        return ARITHBUF_OK;
+}
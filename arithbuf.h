@@ -0,0 +1,55 @@
+/*******************************************************************************
+ *
+ *                                  arithbuf.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the interface for compressing and decompressing images held
+ *      in memory, for programs that link the codec rather than run
+ *      40image. Pixels are 8 bit red, green and blue samples, 3 bytes per
+ *      pixel, with rows stride bytes apart; compressed images are exactly
+ *      the bytes compress40 writes, header included.
+ *
+ *      Every function returns a status instead of asserting, does no I/O
+ *      and allocates no memory, so any number of threads may call them at
+ *      once on different buffers.
+ *
+ *      The functions are in libarithbuf.a (make libarithbuf.a), which holds
+ *      only the block row kernels and the tables they use. A program links
+ *      it with the Arith40 chroma table and the CII exceptions its internal
+ *      checks raise through:
+ *
+ *              cc prog.o libarithbuf.a -larith40 -lcii40 -lm -lpthread
+ *
+ ******************************************************************************/
+
+#ifndef ARITHBUF_INCLUDED
+#define ARITHBUF_INCLUDED
+
+#include <stddef.h>
+
+typedef enum arithbuf_status {
+        ARITHBUF_OK = 0,
+        ARITHBUF_BAD_ARGUMENT,          /* null pointer or short stride */
+        ARITHBUF_TOO_LARGE,             /* sizes overflow a size_t */
+        ARITHBUF_SHORT_BUFFER,          /* output or input buffer too small */
+        ARITHBUF_BAD_FORMAT             /* not a compressed image */
+} arithbuf_status;
+
+const char *arithbuf_message(arithbuf_status status);
+
+size_t arithbuf_compressed_size(unsigned width, unsigned height);
+arithbuf_status arithbuf_compress(const unsigned char *pixels, size_t stride,
+                                  unsigned width, unsigned height,
+                                  unsigned char *out, size_t out_size,
+                                  size_t *written);
+
+arithbuf_status arithbuf_dimensions(const unsigned char *in, size_t in_size,
+                                    unsigned *width, unsigned *height);
+arithbuf_status arithbuf_decompress(const unsigned char *in, size_t in_size,
+                                    unsigned char *pixels, size_t stride,
+                                    size_t pixels_size);
+
+#endif
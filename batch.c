@@ -0,0 +1,543 @@
+/*******************************************************************************
+ *
+ *                                  batch.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains batch mode. Every input file, or every file of an
+ *      input directory, becomes one job on a pool of worker threads; a job
+ *      reads its image's header, waits until the codec for that size fits
+ *      in the memory budget alongside the codecs already in flight, then
+ *      compresses or decompresses the whole image on its own thread with a
+ *      single-threaded codec and writes it to the output directory. Running
+ *      many images at once keeps every core busy without splitting small
+ *      images into bands, and a process started once pays for its
+ *      libraries and tables once, instead of once per image.
+ *
+ *      Each file gets a line on stderr as it finishes, and the batch gets a
+ *      line of totals at the end. A file that is not a whole image fails on
+ *      its own, with its reason on its line and no output left behind,
+ *      and the rest of the batch goes on. The worker threads cannot TRY,
+ *      since the exception stack of the CII is shared by every thread, so
+ *      each input is checked before it is read instead.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "assert.h"
+#include "codec.h"
+#include "container.h"
+#include "ppmio.h"
+#include "pool.h"
+#include "scratch.h"
+#include "stats.h"
+#include "batch.h"
+
+struct batch {
+        const char *outdir;
+        bool compress;
+        unsigned format;                /* 2 or 3, when compressing */
+        coding coding;                  /* of format 3 strips */
+        size_t budget;                  /* bytes for codecs in flight */
+        size_t in_use;                  /* bytes held by codecs in flight */
+        pthread_mutex_t lock;
+        pthread_cond_t released;        /* signalled when in_use drops */
+};
+
+struct file_job {
+        struct batch *b;
+        char *input, *output;
+        bool failed;
+        const char *error;              /* why it failed, if it did */
+        unsigned width, height;         /* of the full-color image */
+        long in_bytes, out_bytes;
+        double seconds;
+};
+
+/********** seconds_since ********
+ *
+ * Measures the time elapsed since a moment
+ *
+ * Inputs:
+ *      const struct timespec *start: the moment
+ *
+ * Return:
+ *      the seconds from start to now, on the monotonic clock
+ ************************/
+static double seconds_since(const struct timespec *start)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (now.tv_sec - start->tv_sec) +
+               (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/********** reserve ********
+ *
+ * Takes memory from a batch's budget, waiting until it is available
+ *
+ * Inputs:
+ *      struct batch *b:        the batch
+ *      size_t bytes:           the memory wanted
+ *
+ * Notes:
+ *      A codec larger than the whole budget is let through once nothing
+ *      else is in flight, so every image is done eventually
+ *      That codec takes in_use past the budget, so the test adds to
+ *      in_use rather than subtracting it from the budget
+ ************************/
+static void reserve(struct batch *b, size_t bytes)
+{
+        pthread_mutex_lock(&b->lock);
+        while (b->in_use > 0 && b->in_use + bytes > b->budget) {
+                pthread_cond_wait(&b->released, &b->lock);
+        }
+        b->in_use += bytes;
+        pthread_mutex_unlock(&b->lock);
+}
+
+/********** release ********
+ *
+ * Returns memory taken by reserve to a batch's budget
+ *
+ * Inputs:
+ *      struct batch *b:        the batch
+ *      size_t bytes:           the memory reserved
+ ************************/
+static void release(struct batch *b, size_t bytes)
+{
+        pthread_mutex_lock(&b->lock);
+        b->in_use -= bytes;
+        pthread_cond_broadcast(&b->released);
+        pthread_mutex_unlock(&b->lock);
+}
+
+/********** holds ********
+ *
+ * Checks that an open file has at least some number of bytes left
+ *
+ * Inputs:
+ *      FILE *fp:       the file
+ *      uint64_t bytes: the bytes wanted
+ *
+ * Return:
+ *      true if the file has that many bytes from where it is to its end
+ ************************/
+static bool holds(FILE *fp, uint64_t bytes)
+{
+        struct stat info;
+        off_t at = ftello(fp);
+        return at >= 0 && fstat(fileno(fp), &info) == 0 &&
+               info.st_size >= at && (uint64_t)(info.st_size - at) >= bytes;
+}
+
+/********** compress_file ********
+ *
+ * Compresses the PPM image in one open file to another
+ *
+ * Inputs:
+ *      struct file_job *job:   the job, which receives the image's size
+ *      FILE *in, *out:         the files read and written
+ *
+ * Return:
+ *      false, with the job's error set, if the file is not a whole PPM
+ *      image
+ *
+ * Notes:
+ *      Format 3 codes its strips on this thread; the rans coding holds a
+ *      coded copy of the code words, so that is reserved as well
+ ************************/
+static bool compress_file(struct file_job *job, FILE *in, FILE *out)
+{
+        if (!ppm_check(in)) {
+                job->error = "not a whole PPM image";
+                return false;
+        }
+        ppm_reader reader = ppm_reader_new(in);
+        job->width = reader->width;
+        job->height = reader->height;
+
+        struct batch *b = job->b;
+        unsigned wib = job->width / 2, hib = job->height / 2;
+        size_t bytes = codec_size(job->width, job->height, 1);
+        if (b->format == 3 && b->coding == CODING_RANS) {
+                bytes += 4 * (size_t)wib * hib;
+        }
+        reserve(b, bytes);
+        codec c = codec_new(job->width, job->height, 1);
+        if (b->format == 3) {
+                container_write(out, wib, hib, codec_encode(c, reader),
+                                b->coding, 1);
+        } else {
+                codec_compress(c, reader, out);
+        }
+        codec_free(&c);
+        release(b, bytes);
+
+        ppm_reader_free(&reader);
+        return true;
+}
+
+/********** decompress_file ********
+ *
+ * Decompresses the compressed image in one open file to another
+ *
+ * Inputs:
+ *      struct file_job *job:   the job, which receives the image's size
+ *      FILE *in, *out:         the files read and written
+ *
+ * Return:
+ *      false, with the job's error set, if the file is not a whole
+ *      compressed image
+ *
+ * Notes:
+ *      Format 3 is decoded one strip at a time, so only a strip's worth
+ *      of memory is reserved for it
+ ************************/
+static bool decompress_file(struct file_job *job, FILE *in, FILE *out)
+{
+        struct comp40_header h;
+        header_status status = container_parse_header(in, &h);
+        if (status != HEADER_OK) {
+                job->error = status == HEADER_EOF ? "empty file"
+                                                  : "not a compressed image";
+                return false;
+        }
+        job->width = h.width;
+        job->height = h.height;
+        if (h.version == 3) {
+                size_t bytes = codec_size(h.width, 2 * h.strip_rows, 1);
+                reserve(job->b, bytes);
+                bool ok = container_decompress(in, &h, 1, out);
+                release(job->b, bytes);
+                if (!ok) {
+                        job->error = "corrupt format 3 image";
+                }
+                return ok;
+        }
+        if (!holds(in, 4 * (uint64_t)(h.width / 2) * (h.height / 2))) {
+                job->error = "the file ends inside the code words";
+                return false;
+        }
+
+        size_t bytes = codec_size(job->width, job->height, 1);
+        reserve(job->b, bytes);
+        codec c = codec_new(job->width, job->height, 1);
+        codec_decompress(c, in, out);
+        codec_free(&c);
+        release(job->b, bytes);
+        return true;
+}
+
+/********** run_file ********
+ *
+ * Compresses or decompresses one file and reports on it
+ *
+ * Inputs:
+ *      void *cl: the file's job
+ *
+ * Notes:
+ *      Run on a worker thread, or on the main thread when there is only
+ *      one; a file that cannot be opened, read or written is reported and
+ *      marked failed rather than stopping the batch, and its output is
+ *      removed
+ ************************/
+static void run_file(void *cl)
+{
+        struct file_job *job = cl;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        /* a job whose output clashes with another's arrives failed */
+        FILE *in = job->error == NULL ? fopen(job->input, "rb") : NULL;
+        FILE *out = in != NULL ? fopen(job->output, "wb") : NULL;
+        if (job->error == NULL && in == NULL) {
+                job->error = "cannot open the input";
+        } else if (in != NULL && out == NULL) {
+                job->error = "cannot create the output";
+        } else if (out != NULL) {
+                job->failed = job->b->compress ? !compress_file(job, in, out)
+                                               : !decompress_file(job, in,
+                                                                  out);
+                job->in_bytes = ftell(in);
+                job->out_bytes = ftell(out);
+                if (fclose(out) != 0 && !job->failed) {
+                        job->error = "cannot write the output";
+                }
+                if (job->error != NULL) {
+                        unlink(job->output);
+                }
+        }
+        job->failed = job->error != NULL;
+        if (in != NULL) {
+                fclose(in);
+        }
+        job->seconds = seconds_since(&start);
+
+        if (job->failed) {
+                fprintf(stderr, "%s: failed: %s\n", job->input, job->error);
+                return;
+        }
+        double megapixels = (double)job->width * job->height / 1e6;
+        fprintf(stderr, "%s: %ux%u, %ld -> %ld bytes, %.3f ms, "
+                "%.1f MP/s\n", job->input, job->width, job->height,
+                job->in_bytes, job->out_bytes, job->seconds * 1e3,
+                job->seconds > 0 ? megapixels / job->seconds : 0);
+}
+
+/********** join ********
+ *
+ * Joins a directory and a file name into a path
+ *
+ * Inputs:
+ *      scratch s:              the scratch the path is allocated from
+ *      const char *dir:        the directory
+ *      const char *name:       the file name
+ *      const char *old_ext:    an extension dropped from name, if present
+ *      const char *new_ext:    an extension added to name
+ *
+ * Return:
+ *      the path
+ ************************/
+static char *join(scratch s, const char *dir, const char *name,
+                  const char *old_ext, const char *new_ext)
+{
+        size_t dir_len = strlen(dir);
+        size_t name_len = strlen(name);
+        size_t old_len = strlen(old_ext);
+        if (name_len > old_len &&
+            strcmp(name + name_len - old_len, old_ext) == 0) {
+                name_len -= old_len;
+        }
+
+        char *path = scratch_alloc(s, dir_len + name_len +
+                                      strlen(new_ext) + 2);
+        sprintf(path, "%s/%.*s%s", dir, (int)name_len, name, new_ext);
+        return path;
+}
+
+/********** add_file ********
+ *
+ * Adds a job for one input file
+ *
+ * Inputs:
+ *      struct batch *b:        the batch
+ *      scratch s:              the scratch the job's paths come from
+ *      struct file_job *jobs:  the jobs, with room for one more
+ *      unsigned *njobs:        the number of jobs, incremented
+ *      char *input:            the input file's path
+ *      const char *name:       the input file's name, without directories
+ ************************/
+static void add_file(struct batch *b, scratch s, struct file_job *jobs,
+                     unsigned *njobs, char *input, const char *name)
+{
+        struct file_job *job = &jobs[(*njobs)++];
+        job->b = b;
+        job->input = input;
+        job->output = b->compress ? join(s, b->outdir, name, ".ppm", ".c40")
+                                  : join(s, b->outdir, name, ".c40", ".ppm");
+}
+
+/********** compare_outputs ********
+ *
+ * The qsort comparison that orders pointers to jobs by output path, and
+ * jobs with the same output in the order they were added
+ *
+ * Inputs:
+ *      const void *a, *b: pointers to the two job pointers
+ *
+ * Return:
+ *      negative, zero or positive as *a goes before, with or after *b
+ ************************/
+static int compare_outputs(const void *a, const void *b)
+{
+        const struct file_job *x = *(struct file_job *const *)a;
+        const struct file_job *y = *(struct file_job *const *)b;
+        int order = strcmp(x->output, y->output);
+        return order != 0 ? order : (x > y) - (x < y);
+}
+
+/********** find_clashes ********
+ *
+ * Fails every job whose output is the same file as an earlier job's
+ *
+ * Inputs:
+ *      scratch s:              the scratch the reasons are allocated from
+ *      struct file_job *jobs:  the jobs
+ *      unsigned njobs:         the number of jobs
+ *
+ * Notes:
+ *      Outputs are named only after their inputs' file names, so a/x.ppm
+ *      and b/x.ppm would both write x.c40; the first one added keeps it,
+ *      and the others fail without opening anything
+ ************************/
+static void find_clashes(scratch s, struct file_job *jobs, unsigned njobs)
+{
+        if (njobs < 2) {
+                return;
+        }
+        struct file_job **sorted = scratch_alloc(s, njobs * sizeof(*sorted));
+        for (unsigned i = 0; i < njobs; i++) {
+                sorted[i] = &jobs[i];
+        }
+        qsort(sorted, njobs, sizeof(*sorted), compare_outputs);
+
+        struct file_job *first = sorted[0];
+        for (unsigned i = 1; i < njobs; i++) {
+                if (strcmp(sorted[i]->output, first->output) != 0) {
+                        first = sorted[i];
+                        continue;
+                }
+                char *error = scratch_alloc(s, strlen(first->input) + 16);
+                sprintf(error, "same output as %s", first->input);
+                sorted[i]->error = error;
+        }
+}
+
+/********** visible ********
+ *
+ * The scandir filter for the files of an input directory
+ *
+ * Inputs:
+ *      const struct dirent *entry: a directory entry
+ *
+ * Return:
+ *      nonzero unless the entry's name starts with a dot
+ ************************/
+static int visible(const struct dirent *entry)
+{
+        return entry->d_name[0] != '.';
+}
+
+/********** batch_run ********
+ *
+ * Compresses or decompresses every input file into an output directory
+ *
+ * Inputs:
+ *      char *inputs[]:         paths of files, and of directories whose
+ *                              files are all inputs
+ *      unsigned ninputs:       the number of paths
+ *      const char *outdir:     the directory the outputs are written to
+ *      bool compress:          true to compress PPM images, false to
+ *                              decompress compressed images
+ *      unsigned format:        the format compressed to, 2 or 3
+ *      coding coding:          how format 3 stores its strips
+ *      unsigned nthreads:      the number of images done at once
+ *      size_t budget:          bytes the codecs of the images in flight
+ *                              may take together
+ *
+ * Return:
+ *      the number of files that failed
+ *
+ * Expects:
+ *      nthreads to be positive
+ *
+ * Notes:
+ *      Only the regular files of a directory are inputs, skipping those
+ *      whose names start with a dot
+ *      Outputs are named after their inputs, with .ppm swapped for .c40
+ *      when compressing and .c40 for .ppm when decompressing; of inputs
+ *      that would write the same output, all but the first fail
+ *      Each image's output is identical to what 40image writes for it,
+ *      with the same format and coding; either format is decompressed
+ ************************/
+unsigned batch_run(char *inputs[], unsigned ninputs, const char *outdir,
+                   bool compress, unsigned format, coding coding,
+                   unsigned nthreads, size_t budget)
+{
+        assert(inputs && outdir && nthreads > 0);
+        assert(format == 2 || format == 3);
+        struct batch b = { outdir, compress, format, coding, budget, 0,
+                           PTHREAD_MUTEX_INITIALIZER,
+                           PTHREAD_COND_INITIALIZER };
+        scratch s = scratch_new();
+
+        struct dirent ***listings = scratch_calloc(s, ninputs,
+                                                   sizeof(*listings));
+        int *counts = scratch_calloc(s, ninputs, sizeof(*counts));
+        size_t total = 0;
+        for (unsigned i = 0; i < ninputs; i++) {
+                struct stat info;
+                if (stat(inputs[i], &info) == 0 && S_ISDIR(info.st_mode)) {
+                        counts[i] = scandir(inputs[i], &listings[i], visible,
+                                            alphasort);
+                        assert(counts[i] >= 0);
+                        stats_allocation(counts[i] * sizeof(struct dirent *));
+                        total += counts[i];
+                } else {
+                        total++;
+                }
+        }
+
+        struct file_job *jobs = scratch_calloc(s, total, sizeof(*jobs));
+        unsigned njobs = 0;
+        for (unsigned i = 0; i < ninputs; i++) {
+                if (listings[i] == NULL) {
+                        const char *slash = strrchr(inputs[i], '/');
+                        add_file(&b, s, jobs, &njobs, inputs[i],
+                                 slash != NULL ? slash + 1 : inputs[i]);
+                        continue;
+                }
+                for (int j = 0; j < counts[i]; j++) {
+                        const char *name = listings[i][j]->d_name;
+                        char *input = join(s, inputs[i], name, "", "");
+                        struct stat info;
+                        if (stat(input, &info) == 0 &&
+                            S_ISREG(info.st_mode)) {
+                                add_file(&b, s, jobs, &njobs, input, name);
+                        }
+                        stats_allocation(listings[i][j]->d_reclen);
+                        free(listings[i][j]);
+                }
+                free(listings[i]);
+        }
+
+        find_clashes(s, jobs, njobs);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pool workers = nthreads > 1 ? pool_new(nthreads) : NULL;
+        for (unsigned i = 0; i < njobs; i++) {
+                if (workers != NULL) {
+                        pool_submit(workers, run_file, &jobs[i]);
+                } else {
+                        run_file(&jobs[i]);
+                }
+        }
+        if (workers != NULL) {
+                pool_wait(workers);
+                pool_free(&workers);
+        }
+        double seconds = seconds_since(&start);
+
+        unsigned failed = 0;
+        double megapixels = 0;
+        long in_bytes = 0, out_bytes = 0;
+        for (unsigned i = 0; i < njobs; i++) {
+                if (jobs[i].failed) {
+                        failed++;
+                        continue;
+                }
+                megapixels += (double)jobs[i].width * jobs[i].height / 1e6;
+                in_bytes += jobs[i].in_bytes;
+                out_bytes += jobs[i].out_bytes;
+        }
+        fprintf(stderr, "batch: %u files, %u failed, %ld -> %ld bytes, "
+                "%.1f MP in %.3f s, %.1f MP/s, %.1f files/s\n", njobs,
+                failed, in_bytes, out_bytes, megapixels, seconds,
+                seconds > 0 ? megapixels / seconds : 0,
+                seconds > 0 ? njobs / seconds : 0);
+
+        scratch_free(&s);
+        return failed;
+}
@@ -0,0 +1,30 @@
+/*******************************************************************************
+ *
+ *                                  batch.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for batch.c. It declares batch mode, which
+ *      compresses or decompresses many files in one process, several at
+ *      once on a pool of worker threads, while keeping the memory their
+ *      codecs take under a budget.
+ *
+ ******************************************************************************/
+
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "container.h"
+
+/* budget for the codecs of the images in flight, when none is given */
+#define BATCH_DEFAULT_BUDGET ((size_t)512 << 20)
+
+unsigned batch_run(char *inputs[], unsigned ninputs, const char *outdir,
+                   bool compress, unsigned format, coding coding,
+                   unsigned nthreads, size_t budget);
+
+#endif
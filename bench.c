@@ -0,0 +1,1179 @@
+/*******************************************************************************
+ *
+ *                                  bench.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the benchmark program. It generates synthetic
+ *      images, the same pixels for the same name and size every run, and
+ *      times each stage of compress40 and decompress40 along with the
+ *      whole-program paths, after warmup runs and over repetitions. Each
+ *      repetition runs its path enough times to take at least
+ *      MIN_SAMPLE_SECONDS, so a sample is never so short that the clock
+ *      and the scheduler decide it, and its time is divided back down to
+ *      one run. The results are written to stdout as JSON, with
+ *      megapixels and bytes per second taken from the fastest sample,
+ *      which noise can only slow.
+ *
+ *      Given a baseline, the JSON of an earlier run, every result is
+ *      compared with the one of the same image and stage in it, and the
+ *      program fails if any has slowed by more than the tolerance and by
+ *      more than its samples, here and in the baseline, vary. The samples
+ *      of every benchmark are interleaved across the run, so that a spell
+ *      of the machine running slow is shared out among them.
+ *
+ *      The paths write to stdout, so while they run file descriptor 1 is
+ *      pointed at /dev/null, or at a temporary file when their output is
+ *      kept; the JSON goes to a duplicate of the original descriptor.
+ *
+ *      Images are held in memory and read through fmemopen, so the stages
+ *      are timed without the disk. The gigapixel image of --large is too
+ *      big for that: it is generated as it is read, and only the streaming
+ *      paths, which hold two rows at a time, are run on it.
+ *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "assert.h"
+#include "compress.h"
+#include "decompress.h"
+#include "stream.h"
+#include "container.h"
+#include "scratch.h"
+
+/* the largest PPM image, in bytes, generated into memory */
+#define MEMORY_LIMIT ((size_t)1 << 30)
+
+#define DEFAULT_REPETITIONS 5
+#define DEFAULT_WARMUP 1
+#define DEFAULT_TOLERANCE 10.0
+
+/* how many times its spread a result must slow by to count as slower */
+#define NOISE_FACTOR 3.0
+
+/* the shortest a sample may be, and the longest calibration may make it */
+#define MIN_SAMPLE_SECONDS 0.05
+#define MAX_SAMPLE_SECONDS 1.0
+
+typedef enum pattern { GRADIENT, NOISE, TEXTURE } pattern;
+
+static const char *pattern_names[] = {
+        [GRADIENT] = "gradient", [NOISE] = "noise", [TEXTURE] = "texture"
+};
+
+struct image {
+        pattern pattern;
+        unsigned width, height;
+        bool quick;                     /* run with --quick */
+        bool large;                     /* run only with --large */
+};
+
+/* thumbnail to 12 megapixels, with odd sizes that have a row and column
+   trimmed, then the gigapixel image */
+static const struct image images[] = {
+        { GRADIENT, 64, 48, true, false },
+        { TEXTURE, 641, 479, true, false },
+        { NOISE, 1024, 768, false, false },
+        { GRADIENT, 1920, 1080, false, false },
+        { TEXTURE, 4001, 3001, false, false },
+        { TEXTURE, 32000, 32000, false, true },
+};
+
+#define NIMAGES (sizeof(images) / sizeof(images[0]))
+
+struct result {
+        char name[64];                  /* the image */
+        const char *stage;
+        double pixels;                  /* after trimming */
+        double bytes;                   /* read by the stage's path */
+        unsigned iterations;            /* runs per sample */
+        double min, median, mean;       /* seconds per run */
+        double baseline;                /* MP/s, or 0 if none */
+        double baseline_min;            /* seconds per run */
+        double baseline_spread;         /* its mean over its min, less 1 */
+};
+
+struct options {
+        unsigned repetitions, warmup;
+        bool quick, large;
+        const char *baseline;
+        double tolerance;               /* percent */
+};
+
+/* /dev/null, where file descriptor 1 points while paths are timed */
+static int discard = -1;
+
+/********** now ********
+ *
+ * Return:
+ *      the seconds on the monotonic clock
+ ************************/
+static double now(void)
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/********** hash ********
+ *
+ * Mixes a pixel's position into well spread bits, for noise that is the
+ * same every run
+ *
+ * Inputs:
+ *      uint32_t x, y:  the pixel's column and row
+ *
+ * Return:
+ *      32 pseudo-random bits
+ ************************/
+static uint32_t hash(uint32_t x, uint32_t y)
+{
+        uint32_t h = x * 0x9e3779b1u ^ (y + 0x7f4a7c15u) * 0x85ebca77u;
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        h *= 0x297a2d39u;
+        return h ^ h >> 15;
+}
+
+/********** clamp ********
+ *
+ * Return:
+ *      x rounded and clamped to a sample from 0 to 255
+ ************************/
+static unsigned char clamp(double x)
+{
+        return x < 0 ? 0 : x > 255 ? 255 : (unsigned char)(x + 0.5);
+}
+
+/********** generate_row ********
+ *
+ * Generates one row of an image's pixels
+ *
+ * Inputs:
+ *      const struct image *image:      the image
+ *      unsigned y:                     the row
+ *      unsigned char *row:             receives 3 samples per pixel
+ *
+ * Notes:
+ *      A gradient runs red across, green down and blue diagonally; noise
+ *      is independent in every sample; a texture is smooth shading with
+ *      tiles of sharp edges and a little grain, like a photograph
+ ************************/
+static void generate_row(const struct image *image, unsigned y,
+                         unsigned char *row)
+{
+        double w = image->width > 1 ? image->width - 1 : 1;
+        double h = image->height > 1 ? image->height - 1 : 1;
+        for (unsigned x = 0; x < image->width; x++) {
+                unsigned char *p = row + 3 * (size_t)x;
+                uint32_t bits = hash(x, y);
+                if (image->pattern == GRADIENT) {
+                        p[0] = clamp(255 * x / w);
+                        p[1] = clamp(255 * y / h);
+                        p[2] = clamp(255 * (x + y) / (w + h));
+                } else if (image->pattern == NOISE) {
+                        p[0] = bits;
+                        p[1] = bits >> 8;
+                        p[2] = bits >> 16;
+                } else {
+                        double shade = 110 + 50 * sin(x * 0.021) *
+                                             cos(y * 0.017) +
+                                       25 * sin((x + 2.0 * y) * 0.004);
+                        if ((x / 97 + y / 61) % 3 == 0) {
+                                shade += 45;
+                        }
+                        double grain = (int)(bits & 15) - 7.5;
+                        p[0] = clamp(shade * 1.10 + grain);
+                        p[1] = clamp(shade * 0.95 + grain);
+                        p[2] = clamp(shade * 0.80 + grain);
+                }
+        }
+}
+
+/********** ppm_header ********
+ *
+ * Writes an image's PPM header
+ *
+ * Inputs:
+ *      const struct image *image:      the image
+ *      char *header:                   receives the header
+ *      size_t size:                    the room in header
+ *
+ * Return:
+ *      the length of the header
+ ************************/
+static size_t ppm_header(const struct image *image, char *header,
+                         size_t size)
+{
+        return snprintf(header, size, "P6\n%u %u\n255\n", image->width,
+                        image->height);
+}
+
+/********** ppm_bytes ********
+ *
+ * Return:
+ *      the size of an image as a PPM file
+ ************************/
+static double ppm_bytes(const struct image *image)
+{
+        char header[64];
+        return ppm_header(image, header, sizeof(header)) +
+               3.0 * image->width * image->height;
+}
+
+/********** generate ********
+ *
+ * Generates an image as a PPM file in memory
+ *
+ * Inputs:
+ *      const struct image *image:      the image
+ *      size_t *size:                   receives the size of the file
+ *
+ * Return:
+ *      the file, malloced
+ ************************/
+static unsigned char *generate(const struct image *image, size_t *size)
+{
+        char header[64];
+        size_t header_bytes = ppm_header(image, header, sizeof(header));
+        size_t row_bytes = 3 * (size_t)image->width;
+        *size = header_bytes + row_bytes * image->height;
+
+        unsigned char *file = malloc(*size);
+        assert(file != NULL);
+        memcpy(file, header, header_bytes);
+        for (unsigned y = 0; y < image->height; y++) {
+                generate_row(image, y, file + header_bytes + y * row_bytes);
+        }
+        return file;
+}
+
+struct source {
+        const struct image *image;
+        char header[64];
+        size_t header_bytes;
+        unsigned char *row;
+        unsigned y;                     /* the row in row */
+        size_t offset;                  /* the next byte read */
+};
+
+/********** source_read ********
+ *
+ * Reads the next bytes of an image generated as it is read, a row at a
+ * time
+ *
+ * Inputs:
+ *      void *cookie:   the struct source
+ *      char *buffer:   receives the bytes
+ *      size_t size:    the room in buffer
+ *
+ * Return:
+ *      the number of bytes read, 0 at the end of the image
+ ************************/
+static ssize_t source_read(void *cookie, char *buffer, size_t size)
+{
+        struct source *source = cookie;
+        const struct image *image = source->image;
+        size_t row_bytes = 3 * (size_t)image->width;
+        size_t done = 0;
+
+        while (done < size) {
+                size_t available;
+                const unsigned char *from;
+                if (source->offset < source->header_bytes) {
+                        from = (unsigned char *)source->header +
+                               source->offset;
+                        available = source->header_bytes - source->offset;
+                } else {
+                        size_t pixel = source->offset - source->header_bytes;
+                        unsigned y = pixel / row_bytes;
+                        if (y >= image->height) {
+                                break;
+                        }
+                        if (y != source->y) {
+                                generate_row(image, y, source->row);
+                                source->y = y;
+                        }
+                        from = source->row + pixel % row_bytes;
+                        available = row_bytes - pixel % row_bytes;
+                }
+                available = available < size - done ? available
+                                                     : size - done;
+                memcpy(buffer + done, from, available);
+                done += available;
+                source->offset += available;
+        }
+        return done;
+}
+
+/********** source_close ********
+ *
+ * Frees an image generated as it is read
+ *
+ * Inputs:
+ *      void *cookie: the struct source
+ *
+ * Return:
+ *      0
+ ************************/
+static int source_close(void *cookie)
+{
+        struct source *source = cookie;
+        free(source->row);
+        free(source);
+        return 0;
+}
+
+/********** source_open ********
+ *
+ * Opens an image as a PPM file generated as it is read
+ *
+ * Inputs:
+ *      const struct image *image: the image
+ *
+ * Return:
+ *      the file, closed with fclose
+ ************************/
+static FILE *source_open(const struct image *image)
+{
+        struct source *source = calloc(1, sizeof(*source));
+        assert(source != NULL);
+        source->image = image;
+        source->header_bytes = ppm_header(image, source->header,
+                                          sizeof(source->header));
+        source->row = malloc(3 * (size_t)image->width);
+        assert(source->row != NULL);
+        source->y = image->height;      /* no row generated yet */
+
+        cookie_io_functions_t functions = {
+                .read = source_read, .close = source_close
+        };
+        FILE *fp = fopencookie(source, "r", functions);
+        assert(fp != NULL);
+        return fp;
+}
+
+struct input {
+        const struct image *image;
+        unsigned char *bytes;           /* in memory, or NULL */
+        size_t size;
+};
+
+/********** input_open ********
+ *
+ * Opens an input for one run
+ *
+ * Inputs:
+ *      const struct input *input: the input
+ *
+ * Return:
+ *      the input's bytes from the start, as a file; a generated image
+ *      when they are not in memory
+ ************************/
+static FILE *input_open(const struct input *input)
+{
+        if (input->bytes == NULL) {
+                return source_open(input->image);
+        }
+        FILE *fp = fmemopen(input->bytes, input->size, "r");
+        assert(fp != NULL);
+        return fp;
+}
+
+/********** redirect ********
+ *
+ * Points stdout at another file, below stdio
+ *
+ * Inputs:
+ *      int fd: the file descriptor stdout writes to from now on
+ *
+ * Notes:
+ *      What stdout has buffered is written out first, where it was meant
+ *      to go
+ ************************/
+static void redirect(int fd)
+{
+        fflush(stdout);
+        int moved = dup2(fd, STDOUT_FILENO);
+        assert(moved == STDOUT_FILENO);
+}
+
+/********** run_path ********
+ *
+ * Runs a path on an input once
+ *
+ * Inputs:
+ *      void (*path)(FILE *):   the path, which writes to stdout
+ *      const struct input *in: the input
+ ************************/
+static void run_path(void (*path)(FILE *), const struct input *in)
+{
+        FILE *fp = input_open(in);
+        path(fp);
+        fflush(stdout);
+        fclose(fp);
+}
+
+/********** capture ********
+ *
+ * Runs a path on an input and keeps what it writes
+ *
+ * Inputs:
+ *      void (*path)(FILE *):   the path, which writes to stdout
+ *      const struct input *in: the input
+ *      struct input *out:      receives what was written, in memory
+ ************************/
+static void capture(void (*path)(FILE *), const struct input *in,
+                    struct input *out)
+{
+        FILE *tmp = tmpfile();
+        assert(tmp != NULL);
+        redirect(fileno(tmp));
+        run_path(path, in);
+        redirect(discard);
+
+        /* the path wrote through the descriptor, so stdio starts over */
+        off_t size = lseek(fileno(tmp), 0, SEEK_END);
+        assert(size >= 0);
+        rewind(tmp);
+        out->image = in->image;
+        out->size = size;
+        out->bytes = malloc(size > 0 ? size : 1);
+        assert(out->bytes != NULL);
+        size_t got = fread(out->bytes, 1, size, tmp);
+        assert(got == (size_t)size);
+        fclose(tmp);
+}
+
+/********** compress40_rans ********
+ *
+ * Compresses to format 3 with the rans coding on one thread
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding a PPM image
+ ************************/
+static void compress40_rans(FILE *fp)
+{
+        compress40_container(fp, CODING_RANS, 1);
+}
+
+/********** drain ********
+ *
+ * Reads a file to its end, to time generating an image that is generated
+ * as it is read
+ *
+ * Inputs:
+ *      FILE *fp: the file
+ ************************/
+static void drain(FILE *fp)
+{
+        char buffer[BUFSIZ];
+        while (fread(buffer, 1, sizeof(buffer), fp) > 0) {
+        }
+}
+
+/********** compare ********
+ *
+ * Sorts seconds in increasing order, for qsort
+ ************************/
+static int compare(const void *a, const void *b)
+{
+        double x = *(const double *)a, y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+/********** summarize ********
+ *
+ * Fills a result from its samples
+ *
+ * Inputs:
+ *      struct result *result:  receives the minimum, median and mean
+ *      double *samples:        the seconds of each repetition, sorted
+ *                              here
+ *      unsigned count:         the number of samples
+ ************************/
+static void summarize(struct result *result, double *samples, unsigned count)
+{
+        qsort(samples, count, sizeof(*samples), compare);
+        double sum = 0;
+        for (unsigned i = 0; i < count; i++) {
+                sum += samples[i];
+        }
+        result->min = samples[0];
+        result->median = count % 2 ? samples[count / 2]
+                                   : (samples[count / 2 - 1] +
+                                      samples[count / 2]) / 2;
+        result->mean = sum / count;
+}
+
+/********** calibrate ********
+ *
+ * Finds how many runs make up one sample
+ *
+ * Inputs:
+ *      double shortest:        the seconds of one run of the shortest
+ *                              stage timed
+ *      double whole:           the seconds of one run of everything timed
+ *                              with it
+ *
+ * Return:
+ *      enough runs for the shortest stage to take MIN_SAMPLE_SECONDS, but
+ *      no more than keep the whole sample under MAX_SAMPLE_SECONDS, and
+ *      at least one
+ ************************/
+static unsigned calibrate(double shortest, double whole)
+{
+        double wanted = shortest > 0 ? ceil(MIN_SAMPLE_SECONDS / shortest)
+                                     : 1e6;
+        double limit = whole > 0 ? floor(MAX_SAMPLE_SECONDS / whole) : 1e6;
+        double runs = wanted < limit ? wanted : limit;
+        return runs < 1 ? 1 : (unsigned)runs;
+}
+
+/* one benchmark: a whole path, or each stage of one and their sum */
+struct timing {
+        const struct input *in;
+        const char *stage;              /* the name of a whole path */
+        void (*path)(FILE *);           /* a whole path, or NULL */
+        void (*run)(const struct input *, double *);    /* or its stages */
+        unsigned nstages;
+        const char *const *names;       /* the stages', then the path's */
+        unsigned first;                 /* its first result */
+        unsigned iterations;            /* runs per sample */
+        double *samples;                /* repetitions per result */
+};
+
+struct bench {
+        const struct options *options;
+        struct result *results;
+        unsigned nresults, capacity;
+        struct timing *timings;
+        unsigned ntimings, timing_capacity;
+};
+
+/********** add_result ********
+ *
+ * Starts a new result
+ *
+ * Inputs:
+ *      struct bench *bench:    the results so far
+ *      const struct input *in: the input the stage reads
+ *      const char *stage:      the stage's name
+ *
+ * Return:
+ *      the result's index, for it to be summarized
+ ************************/
+static unsigned add_result(struct bench *bench, const struct input *in,
+                           const char *stage)
+{
+        if (bench->nresults == bench->capacity) {
+                bench->capacity = 2 * bench->capacity + 16;
+                bench->results = realloc(bench->results, bench->capacity *
+                                         sizeof(*bench->results));
+                assert(bench->results != NULL);
+        }
+        struct result *result = &bench->results[bench->nresults];
+        memset(result, 0, sizeof(*result));
+
+        const struct image *image = in->image;
+        snprintf(result->name, sizeof(result->name), "%s-%ux%u",
+                 pattern_names[image->pattern], image->width, image->height);
+        result->stage = stage;
+        result->pixels = (double)(image->width & ~1u) *
+                         (image->height & ~1u);
+        result->bytes = in->bytes != NULL ? in->size : ppm_bytes(image);
+        return bench->nresults++;
+}
+
+/********** add_timing ********
+ *
+ * Adds a benchmark, and a result for each thing it times
+ *
+ * Inputs:
+ *      struct bench *bench:    the benchmarks so far
+ *      struct timing timing:   the benchmark, with its input and what it
+ *                              runs filled in
+ ************************/
+static void add_timing(struct bench *bench, struct timing timing)
+{
+        if (bench->ntimings == bench->timing_capacity) {
+                bench->timing_capacity = 2 * bench->timing_capacity + 16;
+                bench->timings = realloc(bench->timings,
+                                         bench->timing_capacity *
+                                         sizeof(*bench->timings));
+                assert(bench->timings != NULL);
+        }
+        timing.first = add_result(bench, timing.in, timing.path != NULL
+                                                    ? timing.stage
+                                                    : timing.names[0]);
+        for (unsigned k = 1; k <= timing.nstages; k++) {
+                add_result(bench, timing.in, timing.names[k]);
+        }
+        timing.samples = calloc((timing.nstages + 1) *
+                                (size_t)bench->options->repetitions,
+                                sizeof(double));
+        assert(timing.samples != NULL);
+        bench->timings[bench->ntimings++] = timing;
+}
+
+/********** add_path ********
+ *
+ * Adds a benchmark of a whole path
+ *
+ * Inputs:
+ *      struct bench *bench:    the benchmarks so far
+ *      const char *stage:      the path's name
+ *      void (*path)(FILE *):   the path, which writes to stdout
+ *      const struct input *in: the input
+ ************************/
+static void add_path(struct bench *bench, const char *stage,
+                     void (*path)(FILE *), const struct input *in)
+{
+        add_timing(bench, (struct timing){ .in = in, .stage = stage,
+                                           .path = path });
+}
+
+/********** add_stages ********
+ *
+ * Adds a benchmark of each stage of a path, and of all of them together
+ *
+ * Inputs:
+ *      struct bench *bench:            the benchmarks so far
+ *      const struct input *in:         the input, in memory
+ *      void (*run)(const struct input *, double *):
+ *                                      runs the stages once, adding the
+ *                                      seconds of each to its element
+ *      unsigned nstages:               the number of stages
+ *      const char *const names[]:      the stages' names, then the path's
+ ************************/
+static void add_stages(struct bench *bench, const struct input *in,
+                       void (*run)(const struct input *, double *),
+                       unsigned nstages, const char *const names[])
+{
+        add_timing(bench, (struct timing){ .in = in, .run = run,
+                                           .nstages = nstages,
+                                           .names = names });
+}
+
+/********** run_timing ********
+ *
+ * Runs a benchmark once
+ *
+ * Inputs:
+ *      const struct timing *timing:    the benchmark
+ *      double *seconds:                the seconds of each of its results
+ *                                      are added to its element
+ ************************/
+static void run_timing(const struct timing *timing, double *seconds)
+{
+        if (timing->path != NULL) {
+                double start = now();
+                run_path(timing->path, timing->in);
+                seconds[0] += now() - start;
+                return;
+        }
+        double stages[timing->nstages];
+        memset(stages, 0, sizeof(stages));
+        timing->run(timing->in, stages);
+        for (unsigned k = 0; k < timing->nstages; k++) {
+                seconds[k] += stages[k];
+                seconds[timing->nstages] += stages[k];
+        }
+}
+
+/********** prepare ********
+ *
+ * Warms a benchmark up and finds how many runs make up its samples
+ *
+ * Inputs:
+ *      const struct options *options:  the warmup runs wanted
+ *      struct timing *timing:          the benchmark, which receives its
+ *                                      iterations
+ *
+ * Notes:
+ *      Calibrated so that a sample of the shortest stage takes at least
+ *      MIN_SAMPLE_SECONDS when the whole path allows it
+ ************************/
+static void prepare(const struct options *options, struct timing *timing)
+{
+        unsigned n = timing->nstages + 1;
+        double seconds[n];
+        for (unsigned i = 0; i < options->warmup; i++) {
+                run_timing(timing, seconds);
+        }
+        memset(seconds, 0, sizeof(seconds));
+        run_timing(timing, seconds);
+
+        double shortest = seconds[0];
+        for (unsigned k = 1; k + 1 < n; k++) {
+                shortest = seconds[k] < shortest ? seconds[k] : shortest;
+        }
+        timing->iterations = calibrate(shortest, seconds[n - 1]);
+}
+
+/********** sample ********
+ *
+ * Takes one sample of a benchmark
+ *
+ * Inputs:
+ *      const struct options *options:  the repetitions wanted
+ *      struct timing *timing:          the benchmark, which receives the
+ *                                      sample
+ *      unsigned repetition:            which sample it is
+ ************************/
+static void sample(const struct options *options, struct timing *timing,
+                   unsigned repetition)
+{
+        unsigned n = timing->nstages + 1;
+        double seconds[n];
+        memset(seconds, 0, sizeof(seconds));
+        for (unsigned i = 0; i < timing->iterations; i++) {
+                run_timing(timing, seconds);
+        }
+        for (unsigned k = 0; k < n; k++) {
+                timing->samples[k * options->repetitions + repetition] =
+                        seconds[k] / timing->iterations;
+        }
+}
+
+/********** run_benchmarks ********
+ *
+ * Times every benchmark
+ *
+ * Inputs:
+ *      struct bench *bench: the benchmarks, whose results are summarized
+ *
+ * Notes:
+ *      Each repetition takes one sample of every benchmark, so the samples
+ *      of any one are spread over the whole run; a spell of the machine
+ *      running slow then costs every benchmark one sample, and the fastest
+ *      sample of each is still taken from a quiet spell
+ ************************/
+static void run_benchmarks(struct bench *bench)
+{
+        const struct options *options = bench->options;
+        fprintf(stderr, "bench: warming up and calibrating\n");
+        for (unsigned i = 0; i < bench->ntimings; i++) {
+                prepare(options, &bench->timings[i]);
+        }
+        for (unsigned r = 0; r < options->repetitions; r++) {
+                fprintf(stderr, "bench: repetition %u of %u\n", r + 1,
+                        options->repetitions);
+                for (unsigned i = 0; i < bench->ntimings; i++) {
+                        sample(options, &bench->timings[i], r);
+                }
+        }
+
+        for (unsigned i = 0; i < bench->ntimings; i++) {
+                struct timing *timing = &bench->timings[i];
+                for (unsigned k = 0; k <= timing->nstages; k++) {
+                        struct result *result =
+                                &bench->results[timing->first + k];
+                        result->iterations = timing->iterations;
+                        summarize(result, timing->samples +
+                                          k * options->repetitions,
+                                  options->repetitions);
+                }
+                free(timing->samples);
+        }
+}
+
+/* the stages of compress40, then compress40 as a whole */
+enum {
+        READ_N_TRIM, RGB_TO_COMP_VID, POPULATE_WORDS, PRINT_WORDS,
+        COMPRESS_STAGES
+};
+
+static const char *const compress_stages[COMPRESS_STAGES + 1] = {
+        "read_n_trim", "rgb_to_comp_vid", "populate_words", "print_words",
+        "compress40"
+};
+
+/********** run_compress_stages ********
+ *
+ * Runs the stages of compress40 once
+ *
+ * Inputs:
+ *      const struct input *in: the PPM image, in memory
+ *      double *seconds:        each stage's seconds are added to its
+ *                              element
+ *
+ * Notes:
+ *      populate_words includes init_word_arr and finalizing each word
+ ************************/
+static void run_compress_stages(const struct input *in, double *seconds)
+{
+        double t[COMPRESS_STAGES + 1];
+        FILE *fp = input_open(in);
+        scratch s = scratch_new();
+
+        t[0] = now();
+        meth_bundle image = read_n_trim(fp, s);
+        t[1] = now();
+        UArray2b_T comp_vid = rgb_to_comp_vid(image, s);
+        t[2] = now();
+        UArray2_T words = init_word_arr(comp_vid, s);
+        populate_words(comp_vid, words);
+        t[3] = now();
+        printf("COMP40 Compressed image format 2\n%u %u\n",
+               image->methods->width(image->array),
+               image->methods->height(image->array));
+        print_words(words, s);
+        fflush(stdout);
+        t[4] = now();
+
+        scratch_free(&s);
+        fclose(fp);
+        for (int k = 0; k < COMPRESS_STAGES; k++) {
+                seconds[k] += t[k + 1] - t[k];
+        }
+}
+
+/* the stages of decompress40, then decompress40 as a whole */
+enum {
+        READ_WORD_ARR, WORDS_TO_COMP_VID, COMP_VID_TO_RGB, WRITE_RGB,
+        DECOMPRESS_STAGES
+};
+
+static const char *const decompress_stages[DECOMPRESS_STAGES + 1] = {
+        "read_word_arr", "words_to_comp_vid", "comp_vid_to_rgb", "write_rgb",
+        "decompress40"
+};
+
+/********** run_decompress_stages ********
+ *
+ * Runs the stages of decompress40 once
+ *
+ * Inputs:
+ *      const struct input *in: the image in format 2, in memory
+ *      double *seconds:        each stage's seconds are added to its
+ *                              element
+ *
+ * Notes:
+ *      read_word_arr includes reading the header
+ ************************/
+static void run_decompress_stages(const struct input *in, double *seconds)
+{
+        double t[DECOMPRESS_STAGES + 1];
+        FILE *fp = input_open(in);
+        scratch s = scratch_new();
+
+        t[0] = now();
+        struct comp40_header header;
+        bool read = container_read_header(fp, &header);
+        assert(read && header.version == 2);
+        UArray2_T words = read_word_arr(fp, header.width, header.height, s);
+        t[1] = now();
+        UArray2b_T comp_vid = words_to_comp_vid(words, s);
+        t[2] = now();
+        UArray2_T rgb = comp_vid_to_rgb(comp_vid, s);
+        t[3] = now();
+        write_rgb(stdout, rgb);
+        fflush(stdout);
+        t[4] = now();
+
+        scratch_free(&s);
+        fclose(fp);
+        for (int k = 0; k < DECOMPRESS_STAGES; k++) {
+                seconds[k] += t[k + 1] - t[k];
+        }
+}
+
+/* the inputs of one image's benchmarks */
+struct inputs {
+        struct input ppm, comp40, rans;
+};
+
+/********** add_image ********
+ *
+ * Prepares the inputs of one image and adds every benchmark on it
+ *
+ * Inputs:
+ *      struct bench *bench:            receives the benchmarks
+ *      const struct image *image:      the image
+ *      struct inputs *inputs:          receives the inputs, freed by
+ *                                      free_inputs once the benchmarks
+ *                                      have run
+ *
+ * Notes:
+ *      An image too big for memory runs only the streaming paths, and is
+ *      decompressed only if its compressed form fits; generating it is
+ *      part of compressing it, so the time to generate it alone is given
+ *      as the stage "generate"
+ ************************/
+static void add_image(struct bench *bench, const struct image *image,
+                      struct inputs *inputs)
+{
+        struct input *ppm = &inputs->ppm;
+        *ppm = (struct input){ image, NULL, 0 };
+        bool in_memory = ppm_bytes(image) <= MEMORY_LIMIT;
+        if (in_memory) {
+                ppm->bytes = generate(image, &ppm->size);
+        }
+
+        inputs->rans = (struct input){ image, NULL, 0 };
+        capture(compress40_stream, ppm, &inputs->comp40);
+
+        if (in_memory) {
+                add_stages(bench, ppm, run_compress_stages, COMPRESS_STAGES,
+                           compress_stages);
+        } else {
+                add_path(bench, "generate", drain, ppm);
+        }
+        add_path(bench, "compress40_stream", compress40_stream, ppm);
+        if (in_memory) {
+                capture(compress40_rans, ppm, &inputs->rans);
+                add_path(bench, "compress40_rans", compress40_rans, ppm);
+                add_stages(bench, &inputs->comp40, run_decompress_stages,
+                           DECOMPRESS_STAGES, decompress_stages);
+        }
+        add_path(bench, "decompress40_stream", decompress40_stream,
+                 &inputs->comp40);
+        if (in_memory) {
+                add_path(bench, "decompress40_rans", decompress40_stream,
+                         &inputs->rans);
+        }
+}
+
+/********** free_inputs ********
+ *
+ * Frees the inputs of one image
+ *
+ * Inputs:
+ *      struct inputs *inputs: the inputs
+ ************************/
+static void free_inputs(struct inputs *inputs)
+{
+        free(inputs->rans.bytes);
+        free(inputs->comp40.bytes);
+        free(inputs->ppm.bytes);
+}
+
+/********** read_baseline ********
+ *
+ * Attaches to each result the speed of the same image and stage in a
+ * baseline, and the spread of its samples
+ *
+ * Inputs:
+ *      struct bench *bench:    the results
+ *      const char *path:       the JSON of an earlier run
+ *
+ * Notes:
+ *      Reads the one result per line that print_json writes; a result
+ *      missing from the baseline is not compared
+ ************************/
+static void read_baseline(struct bench *bench, const char *path)
+{
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL) {
+                fprintf(stderr, "bench: cannot open baseline '%s'\n", path);
+                exit(1);
+        }
+
+        char line[512];
+        while (fgets(line, sizeof(line), fp) != NULL) {
+                char name[64], stage[64];
+                double min, mean, speed;
+                const char *times = strstr(line, "\"min_s\": ");
+                if (times == NULL ||
+                    sscanf(line, " { \"image\": \"%63[^\"]\", \"stage\": "
+                           "\"%63[^\"]\"", name, stage) != 2 ||
+                    sscanf(times, "\"min_s\": %lf, \"median_s\": %*f, "
+                           "\"mean_s\": %lf, \"mp_per_s\": %lf", &min,
+                           &mean, &speed) != 3 || min <= 0) {
+                        continue;
+                }
+                for (unsigned i = 0; i < bench->nresults; i++) {
+                        struct result *result = &bench->results[i];
+                        if (strcmp(result->name, name) == 0 &&
+                            strcmp(result->stage, stage) == 0) {
+                                result->baseline = speed;
+                                result->baseline_min = min;
+                                result->baseline_spread = mean / min - 1;
+                        }
+                }
+        }
+        fclose(fp);
+}
+
+/********** print_json ********
+ *
+ * Writes the results as JSON, one result per line
+ *
+ * Inputs:
+ *      const struct bench *bench:      the results
+ *      FILE *out:                      the file written to
+ *
+ * Return:
+ *      the number of results slower than their baseline by more than the
+ *      tolerance and their noise floor
+ *
+ * Notes:
+ *      A result counts as slower only if it slowed by more than both the
+ *      tolerance and its noise floor: NOISE_FACTOR times the spread of its
+ *      samples, how far their mean is above their minimum, in this run
+ *      and the baseline together. The floor is in time, so it is held
+ *      against how much longer the fastest sample took, not against the
+ *      fall in speed. A result whose samples disagree with each other
+ *      says that little about the code
+ ************************/
+static unsigned print_json(const struct bench *bench, FILE *out)
+{
+        const struct options *options = bench->options;
+        unsigned regressions = 0;
+
+        fprintf(out, "{\n  \"repetitions\": %u,\n  \"warmup\": %u,\n",
+                options->repetitions, options->warmup);
+        fprintf(out, "  \"results\": [\n");
+        for (unsigned i = 0; i < bench->nresults; i++) {
+                const struct result *r = &bench->results[i];
+                double speed = r->pixels / 1e6 / r->min;
+                fprintf(out, "    { \"image\": \"%s\", \"stage\": \"%s\", "
+                        "\"iterations\": %u, \"min_s\": %.9f, "
+                        "\"median_s\": %.9f, \"mean_s\": %.9f, "
+                        "\"mp_per_s\": %.3f, \"bytes_per_s\": %.0f",
+                        r->name, r->stage, r->iterations, r->min, r->median,
+                        r->mean, speed, r->bytes / r->min);
+                if (r->baseline > 0) {
+                        double change = 100 * (speed / r->baseline - 1);
+                        double slowdown = 100 * (r->min / r->baseline_min -
+                                                 1);
+                        double noise = 100 * NOISE_FACTOR *
+                                       (r->mean / r->min - 1 +
+                                        r->baseline_spread);
+                        bool regressed = change < -options->tolerance &&
+                                         slowdown > noise;
+                        regressions += regressed;
+                        fprintf(out, ", \"baseline_mp_per_s\": %.3f, "
+                                "\"change_pct\": %.1f, \"noise_pct\": %.1f, "
+                                "\"regressed\": %s", r->baseline, change,
+                                noise, regressed ? "true" : "false");
+                }
+                fprintf(out, " }%s\n", i + 1 < bench->nresults ? "," : "");
+        }
+        fprintf(out, "  ]");
+        if (options->baseline != NULL) {
+                fprintf(out, ",\n  \"tolerance_pct\": %.1f,\n"
+                        "  \"regressions\": %u", options->tolerance,
+                        regressions);
+        }
+        fprintf(out, "\n}\n");
+        return regressions;
+}
+
+/********** usage ********
+ *
+ * Reports how the program is run and exits
+ *
+ * Inputs:
+ *      const char *program: the program's name
+ ************************/
+__attribute__((noreturn))
+static void usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-r repetitions] [-w warmup] [--quick] "
+                "[--large]\n"
+                "       [--baseline file.json] [--tolerance percent]\n",
+                program);
+        exit(1);
+}
+
+/********** main ********
+ *
+ * This is the driver for the benchmark program
+ *
+ * Inputs:
+ *      int argc:       the number of command line arguments
+ *      char *argv[]:   array containing the command line arguments
+ *
+ * Return:
+ *      EXIT_SUCCESS, or EXIT_FAILURE if a result regressed against the
+ *      baseline
+ *
+ * Notes:
+ *      -r and -w set the repetitions timed and the warmup runs before
+ *      them; --quick runs only the small images; --large adds a
+ *      gigapixel image, which needs over a gigabyte of memory; progress
+ *      is reported on stderr
+ ************************/
+int main(int argc, char *argv[])
+{
+        struct options options = {
+                DEFAULT_REPETITIONS, DEFAULT_WARMUP, false, false, NULL,
+                DEFAULT_TOLERANCE
+        };
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+                        int n = atoi(argv[++i]);
+                        if (n <= 0) {
+                                usage(argv[0]);
+                        }
+                        options.repetitions = n;
+                } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+                        options.warmup = atoi(argv[++i]);
+                } else if (strcmp(argv[i], "--quick") == 0) {
+                        options.quick = true;
+                } else if (strcmp(argv[i], "--large") == 0) {
+                        options.large = true;
+                } else if (strcmp(argv[i], "--baseline") == 0 &&
+                           i + 1 < argc) {
+                        options.baseline = argv[++i];
+                } else if (strcmp(argv[i], "--tolerance") == 0 &&
+                           i + 1 < argc) {
+                        options.tolerance = atof(argv[++i]);
+                } else {
+                        usage(argv[0]);
+                }
+        }
+
+        /* the JSON keeps the real stdout; the paths write to /dev/null */
+        fflush(stdout);
+        FILE *json = fdopen(dup(STDOUT_FILENO), "w");
+        discard = open("/dev/null", O_WRONLY);
+        assert(json != NULL && discard >= 0);
+        redirect(discard);
+
+        struct bench bench = { &options, NULL, 0, 0, NULL, 0, 0 };
+        struct inputs inputs[NIMAGES];
+        unsigned ninputs = 0;
+        for (unsigned i = 0; i < NIMAGES; i++) {
+                const struct image *image = &images[i];
+                if ((options.quick && !image->quick) ||
+                    (!options.large && image->large)) {
+                        continue;
+                }
+                fprintf(stderr, "bench: %s %ux%u\n",
+                        pattern_names[image->pattern], image->width,
+                        image->height);
+                add_image(&bench, image, &inputs[ninputs++]);
+        }
+        run_benchmarks(&bench);
+        for (unsigned i = 0; i < ninputs; i++) {
+                free_inputs(&inputs[i]);
+        }
+
+        if (options.baseline != NULL) {
+                read_baseline(&bench, options.baseline);
+        }
+        unsigned regressions = print_json(&bench, json);
+        fclose(json);
+        if (regressions > 0) {
+                fprintf(stderr, "bench: %u results regressed by more than "
+                        "%.1f%%\n", regressions, options.tolerance);
+        }
+        free(bench.timings);
+        free(bench.results);
+        return regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
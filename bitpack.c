@@ -13,11 +13,27 @@
  *
  ******************************************************************************/
 
-#include <math.h>
-
 #include "bitpack.h"
 #include "assert.h"
 
+/********** low_bits ********
+ *
+ * Returns a mask of the low width bits of a 64 bit word
+ *
+ * Inputs:
+ *      unsigned width: number of bits in the mask
+ * 
+ * Expects:
+ *      width to be less than or equal to 64
+ *
+ * Notes:
+ *      Shifting a 64 bit value by 64 is undefined, so a full width mask is
+ *      built from the complement instead
+ ************************/
+static inline uint64_t low_bits(unsigned width)
+{
+        return width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+}
 
 /********** Bitpack_fitsu ********
  *
@@ -37,7 +53,7 @@
 bool Bitpack_fitsu(uint64_t n, unsigned width)
 {
         assert(width <= 64);
-        return n <= pow(2, width) - 1;
+        return n <= low_bits(width);
 }
 
 /********** Bitpack_fitss ********
@@ -58,7 +74,13 @@ bool Bitpack_fitsu(uint64_t n, unsigned width)
 bool Bitpack_fitss(int64_t n, unsigned width)
 {
         assert(width <= 64);
-        return (n <= pow(2, width-1) - 1) && (n >= -(pow(2, width-1)));
+        if (width == 0) {
+                return false;
+        }
+        /* the range of a signed field is half the range of an unsigned */
+        /* one, shifted down: n fits when n + 2^(width - 1) fits width   */
+        uint64_t half = (uint64_t)1 << (width - 1);
+        return (uint64_t)n + half <= low_bits(width);
 }
 
 /********** Bitpack_getu ********
@@ -86,7 +108,7 @@ uint64_t Bitpack_getu(uint64_t word, unsigned width, unsigned lsb)
                 return 0;
         }
 
-        uint64_t mask = (((1 << width) - 1) << lsb);
+        uint64_t mask = low_bits(width) << lsb;
         uint64_t extracted_val = word & mask;
 
         extracted_val = extracted_val >> lsb;
@@ -119,7 +141,7 @@ int64_t Bitpack_gets(uint64_t word, unsigned width, unsigned lsb)
                 return 0;
         }
         
-        int64_t mask = (((1 << width) - 1) << lsb);
+        uint64_t mask = low_bits(width) << lsb;
         int64_t extracted_val = word & mask;
 
         extracted_val = extracted_val << (64 - width - lsb);
@@ -151,7 +173,7 @@ uint64_t Bitpack_newu(uint64_t word, unsigned width, unsigned lsb,
         assert(width <= 64);
         assert(width + lsb <= 64);
         
-        uint64_t mask = ~(((1 << width) - 1) << lsb);
+        uint64_t mask = ~(low_bits(width) << lsb);
         word = word & mask;
 
         value = value << lsb;
@@ -185,10 +207,10 @@ uint64_t Bitpack_news(uint64_t word, unsigned width, unsigned lsb,
         assert(width <= 64);
         assert(width + lsb <= 64);
         
-        uint64_t mask = ~(((1 << width) - 1) << lsb);
+        uint64_t mask = ~(low_bits(width) << lsb);
         word = word & mask;
 
-        uint64_t val_mask = ((1 << width) - 1);
+        uint64_t val_mask = low_bits(width);
         value = value & val_mask;
         value = value << lsb;
 
@@ -0,0 +1,304 @@
+/*******************************************************************************
+ *
+ *                                 blockrow.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the block row steps shared by every compressor
+ *      and decompressor: encode_block_row turns two rows of pixels into one
+ *      row of code words and decode_block_row does the reverse. It also
+ *      holds the per word and per pixel decompression steps, which the
+ *      array based decompressor uses directly and the bulk kernels in
+ *      convert.c fall back on. Nothing here reads a file or builds a
+ *      UArray, so libarithbuf.a carries this file instead of stream.c
+ *      and decompress.c.
+ *
+ ******************************************************************************/
+
+#include <assert.h>
+#include "codeword.h"
+#include "quant.h"
+#include "convert.h"
+#include "fixed.h"
+#include "blockrow.h"
+
+/* pixels per row converted by each call to the bulk conversion kernel */
+#define SPAN 64
+
+/********** encode_block_row ********
+ *
+ * Computes the code words for one row of 2x2 blocks
+ *
+ * Inputs:
+ *      const struct rgb16 *top:        the upper row of pixels
+ *      const struct rgb16 *bottom:     the lower row of pixels
+ *      unsigned width_in_blocks:       the number of blocks in the row
+ *      unsigned denominator:           the denominator of the image
+ *      uint32_t *words:                receives one code word per block
+ *
+ * Expects:
+ *      top and bottom to hold at least 2 * width_in_blocks pixels
+ *      words to have room for width_in_blocks code words
+ *
+ * Notes:
+ *      Pixels are converted SPAN at a time by the bulk kernel in convert.c
+ *      The array based compressor visits the pixels of a block in the
+ *      order top left, bottom left, top right, bottom right, so the sums
+ *      are accumulated in that same order to round identically
+ *      The sums of a span are quantized and packed in one pass by
+ *      quantize_block_row
+ *      Runs fixed_encode_block_row instead when fixed point is selected
+ ************************/
+void encode_block_row(const struct rgb16 *top, const struct rgb16 *bottom,
+                      unsigned width_in_blocks, unsigned denominator,
+                      uint32_t *words)
+{
+        assert(top && bottom && words);
+        if (fixed_point_selected()) {
+                fixed_encode_block_row(top, bottom, width_in_blocks,
+                                       denominator, words);
+                return;
+        }
+        double recip = 1.0 / denominator;
+        unsigned width = 2 * width_in_blocks;
+
+        /* planar component video for a span of both rows, top row first */
+        float y[2][SPAN], pb[2][SPAN], pr[2][SPAN];
+        /* planar sums of each block of the span */
+        float pb_sum[SPAN / 2], pr_sum[SPAN / 2];
+        float a[SPAN / 2], b[SPAN / 2], c[SPAN / 2], d[SPAN / 2];
+
+        for (unsigned start = 0; start < width; start += SPAN) {
+                unsigned count = width - start < SPAN ? width - start : SPAN;
+                rgb_to_ypbpr_span(top + start, count, recip, 
+                                  y[0], pb[0], pr[0]);
+                rgb_to_ypbpr_span(bottom + start, count, recip, 
+                                  y[1], pb[1], pr[1]);
+
+                for (unsigned k = 0; k < count / 2; k++) {
+                        unsigned i = 2 * k;
+                        pb_sum[k] = pb[0][i] + pb[1][i] + 
+                                    pb[0][i + 1] + pb[1][i + 1];
+                        pr_sum[k] = pr[0][i] + pr[1][i] + 
+                                    pr[0][i + 1] + pr[1][i + 1];
+                        a[k] = y[0][i] + y[1][i] + y[0][i + 1] + y[1][i + 1];
+                        b[k] = -y[0][i] + y[1][i] - y[0][i + 1] + y[1][i + 1];
+                        c[k] = -y[0][i] - y[1][i] + y[0][i + 1] + y[1][i + 1];
+                        d[k] = y[0][i] - y[1][i] - y[0][i + 1] + y[1][i + 1];
+                }
+
+                quantize_block_row(pb_sum, pr_sum, a, b, c, d, count / 2,
+                                   words + start / 2);
+        }
+}
+
+/********** encode_block_row8 ********
+ *
+ * Computes the code words for one row of 2x2 blocks of 8-bit pixels
+ *
+ * Inputs:
+ *      const struct rgb8 *top:         the upper row of pixels
+ *      const struct rgb8 *bottom:      the lower row of pixels
+ *      unsigned width_in_blocks:       the number of blocks in the row
+ *      unsigned denominator:           the denominator of the image
+ *      uint32_t *words:                receives one code word per block
+ *
+ * Expects:
+ *      the same as encode_block_row, and denominator to be at most 255
+ *
+ * Notes:
+ *      Each SPAN of both rows is widened to rgb16 on the stack and handed
+ *      to encode_block_row, so the code words are exactly its code words
+ *      for the same pixels
+ ************************/
+void encode_block_row8(const struct rgb8 *top, const struct rgb8 *bottom,
+                       unsigned width_in_blocks, unsigned denominator,
+                       uint32_t *words)
+{
+        assert(top && bottom && words);
+        assert(denominator < 256);
+        unsigned width = 2 * width_in_blocks;
+        struct rgb16 wide[2][SPAN];
+
+        for (unsigned start = 0; start < width; start += SPAN) {
+                unsigned count = width - start < SPAN ? width - start : SPAN;
+                for (unsigned i = 0; i < count; i++) {
+                        const struct rgb8 *t = &top[start + i];
+                        const struct rgb8 *b = &bottom[start + i];
+                        wide[0][i] = (struct rgb16){ t->red, t->green,
+                                                     t->blue };
+                        wide[1][i] = (struct rgb16){ b->red, b->green,
+                                                     b->blue };
+                }
+                encode_block_row(wide[0], wide[1], count / 2, denominator,
+                                 words + start / 2);
+        }
+}
+
+/********** decode_block_row ********
+ *
+ * Computes the two rows of pixels described by one row of code words
+ *
+ * Inputs:
+ *      const uint32_t *words:          the code words, one per block
+ *      unsigned width_in_blocks:       the number of blocks in the row
+ *      unsigned char *top:             receives the upper row of pixels
+ *      unsigned char *bottom:          receives the lower row of pixels
+ *
+ * Expects:
+ *      top and bottom to have room for 2 * width_in_blocks pixels, 3 bytes
+ *      per pixel
+ *
+ * Notes:
+ *      Pixels are written as raw pixmap samples with a denominator of 255
+ *      by the fused decode kernel in convert.c, or by
+ *      fixed_decode_block_row when fixed point is selected
+ ************************/
+void decode_block_row(const uint32_t *words, unsigned width_in_blocks,
+                      unsigned char *top, unsigned char *bottom)
+{
+        assert(words && top && bottom);
+        if (fixed_point_selected()) {
+                fixed_decode_block_row(words, width_in_blocks, top, bottom);
+        } else {
+                words_to_rgb_rows(words, width_in_blocks, top, bottom);
+        }
+}
+
+/********** unpack_word ********
+ * 
+ * Unpacks the fields of a code word into a word_info struct
+ * 
+ * Inputs:
+ *      uint64_t word:        code word holding the packed fields
+ *      word_info word_data:  the struct receiving the fields
+ * 
+ * Expects:
+ *      word_data to not be null
+ ************************/
+void unpack_word(uint64_t word, word_info word_data)
+{
+        assert(word_data);
+        struct codeword fields;
+        codeword_unpack(word, &fields);
+
+        word_data->a = fields.a;
+        word_data->b = fields.b;
+        word_data->c = fields.c;
+        word_data->d = fields.d;
+        word_data->avg_pb = fields.pb;
+        word_data->avg_pr = fields.pr;
+}
+
+/********** word_to_comp_vid ********
+ * 
+ * Computes the component video values of the four pixels of a 2x2 block
+ * from the unpacked fields of its code word
+ *
+ * Inputs:
+ *      const struct word_info *word_data: the unpacked code word
+ *      struct comp_vid block[4]:          receives the top left, top right,
+ *                                         bottom left and bottom right 
+ *                                         pixels, in that order
+ * 
+ * Expects:
+ *      No pointers to be null, the fields to be those of a code word
+ *
+ * Notes:
+ *      Dequantizes through the tables in quant.c rather than dividing
+ ************************/
+void word_to_comp_vid(const struct word_info *word_data, 
+                      struct comp_vid block[4])
+{
+        assert(word_data);
+        assert(block);
+
+        const struct dequant_tables *tables = dequant_tables();
+
+        /* b, c and d are looked up by the raw bits of their 5 bit fields */
+        float a = tables->a[(unsigned) word_data->a];
+        float b = tables->bcd[(int) word_data->b & 31];
+        float c = tables->bcd[(int) word_data->c & 31];
+        float d = tables->bcd[(int) word_data->d & 31];
+
+        float pb = tables->chroma[(unsigned) word_data->avg_pb];
+        float pr = tables->chroma[(unsigned) word_data->avg_pr];
+
+        block[0].y = a - b - c + d;
+        block[1].y = a - b + c - d;
+        block[2].y = a + b - c - d;
+        block[3].y = a + b + c + d;
+        for (int i = 0; i < 4; i++) {
+                block[i].pb = pb;
+                block[i].pr = pr;
+        }
+}
+
+/********** comp_vid_to_rgb_pixel ********
+ * 
+ * Converts a single pixel from component video to rgb format
+ *
+ * Inputs:
+ *      const struct comp_vid *comp_vid_vals:  the pixel being converted
+ *      Pnm_rgb rgb_cell:                      receives the rgb values, 
+ *                                             with a denominator of 255
+ * 
+ * Expects:
+ *      No pointers to be null
+ * 
+ * Notes:
+ *      Shared by the array based decompressor and the streaming
+ *      decompressor so both produce exactly the same pixels
+ ************************/
+void comp_vid_to_rgb_pixel(const struct comp_vid *comp_vid_vals, 
+                           Pnm_rgb rgb_cell)
+{
+        assert(comp_vid_vals);
+        assert(rgb_cell);
+
+        float y = comp_vid_vals->y;
+        float pb = comp_vid_vals->pb;
+        float pr = comp_vid_vals->pr;
+
+        float r = 1.0 * y + 0.0 * pb + 1.402 * pr;
+        float g = 1.0 * y - 0.344136 * pb - 0.714136 * pr;
+        float b = 1.0 * y + 1.772 * pb + 0.0 * pr;
+        
+        rgb_cell->red = quantize_rgb(r);
+        rgb_cell->green = quantize_rgb(g);
+        rgb_cell->blue = quantize_rgb(b);
+}
+
+/********** quantize_rgb ********
+ * 
+ * Quantizes an rgb value by multiplying it by a denominator of 255 and
+ * truncating the remainder
+ *
+ * Inputs:
+ *      float color:  the value being quantized
+ * 
+ * Returns:
+ *      Unsigned representing the quantized color value
+ * 
+ * Expects:
+ *      color to be a value between 0 and 1
+ * 
+ * Notes:
+ *      prepares rgb values to correspond with the final image denominator
+ *      of 255 which is assigned later
+ ************************/
+unsigned quantize_rgb(float color)
+{
+        unsigned denominator = 255;
+        if (color > 1) {
+                color = 1;
+        }
+        if (color < 0) {
+                color = 0;
+        }
+        
+        unsigned quantized_color = color * denominator;
+        return quantized_color; 
+}
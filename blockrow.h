@@ -0,0 +1,39 @@
+/*******************************************************************************
+ *
+ *                                 blockrow.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for blockrow.c. It declares the steps that
+ *      turn one row of 2x2 blocks into code words and back, and the per
+ *      word and per pixel steps of decompression they are checked against.
+ *      None of them touch a file or a UArray, so the in-memory codec of
+ *      arithbuf.h links them without the rest of the program.
+ *
+ ******************************************************************************/
+
+#ifndef BLOCKROW_INCLUDED
+#define BLOCKROW_INCLUDED
+
+#include <stdint.h>
+#include <pnm.h>
+#include "struct_def.h"
+
+void encode_block_row(const struct rgb16 *top, const struct rgb16 *bottom,
+                      unsigned width_in_blocks, unsigned denominator,
+                      uint32_t *words);
+void encode_block_row8(const struct rgb8 *top, const struct rgb8 *bottom,
+                       unsigned width_in_blocks, unsigned denominator,
+                       uint32_t *words);
+void decode_block_row(const uint32_t *words, unsigned width_in_blocks,
+                      unsigned char *top, unsigned char *bottom);
+void unpack_word(uint64_t word, word_info word_data);
+void word_to_comp_vid(const struct word_info *word_data, 
+                      struct comp_vid block[4]);
+void comp_vid_to_rgb_pixel(const struct comp_vid *comp_vid_vals, 
+                           Pnm_rgb rgb_cell);
+unsigned quantize_rgb(float color);
+
+#endif
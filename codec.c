@@ -0,0 +1,399 @@
+/*******************************************************************************
+ *
+ *                                  codec.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the reusable codec context. codec_new allocates,
+ *      from a scratch that lives as long as the codec, room for every
+ *      pixel and code word of one image, splits the rows of blocks into
+ *      ranges once, starts the worker threads and builds the quantization
+ *      tables. codec_compress and codec_decompress then read an image
+ *      into those buffers, run the block row kernels of stream.c over
+ *      the ranges on the workers, and write the result, without
+ *      allocating anything.
+ *
+ *      Pixels are held packed: as struct rgb8 when a raw image's samples
+ *      fit in a byte, which halves what each image touches, and as struct
+ *      rgb16 otherwise, which is what the room is allocated for.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include "assert.h"
+#include "codeword.h"
+#include "quant.h"
+#include "stream.h"
+#include "pool.h"
+#include "scratch.h"
+#include "stats.h"
+#include "codec.h"
+
+/* ranges of block rows per worker thread, for balance */
+#define RANGES_PER_THREAD 4
+
+struct range {
+        codec c;
+        unsigned first_row, last_row;   /* rows of blocks, half open */
+};
+
+struct codec {
+        unsigned width_in_blocks, height_in_blocks;
+        unsigned denominator;           /* of the image being compressed */
+        scratch s;                      /* holds everything below */
+        pool workers;                   /* NULL when running on one thread */
+        struct range *ranges;
+        unsigned nranges;
+        unsigned stride;                /* pixels per row of pixels */
+        bool narrow;                    /* pixels are rgb8, not rgb16 */
+        void *pixels;                   /* every row, plus an odd last one */
+        uint32_t *words;                /* every code word */
+        unsigned char *bytes;           /* the code words as written */
+        unsigned char *raster;          /* the decompressed image */
+};
+
+/********** count_ranges ********
+ *
+ * Decides how many ranges the rows of blocks of an image are split into
+ *
+ * Inputs:
+ *      unsigned height_in_blocks:      the rows of blocks in the image
+ *      unsigned nthreads:              the number of threads to run on
+ *
+ * Return:
+ *      the number of ranges, at most one per row of blocks
+ ************************/
+static unsigned count_ranges(unsigned height_in_blocks, unsigned nthreads)
+{
+        unsigned nranges = nthreads > 1 ? nthreads * RANGES_PER_THREAD : 1;
+        return nranges < height_in_blocks ? nranges : height_in_blocks;
+}
+
+/********** codec_size ********
+ *
+ * Computes how much memory codec_new takes for images of one size
+ *
+ * Inputs:
+ *      unsigned width, height: the size of the full-color images
+ *      unsigned nthreads:      the number of threads to run on
+ *
+ * Return:
+ *      the bytes allocated for the codec and its buffers, not counting
+ *      its worker threads
+ ************************/
+size_t codec_size(unsigned width, unsigned height, unsigned nthreads)
+{
+        size_t wib = width / 2;
+        size_t hib = height / 2;
+        size_t blocks = wib * hib;
+
+        return sizeof(struct codec) +
+               (2 * hib + 1) * (2 * wib + 1) * sizeof(struct rgb16) +
+               blocks * (sizeof(uint32_t) + 4 + 12) +
+               count_ranges(hib, nthreads) * sizeof(struct range) +
+               6 * SCRATCH_ALIGNMENT;
+}
+
+/********** codec_new ********
+ *
+ * Makes a codec for images of one size
+ *
+ * Inputs:
+ *      unsigned width, height: the size of the full-color images; an odd
+ *                              last row or column is trimmed, so the
+ *                              compressed images have the even size below
+ *      unsigned nthreads:      the number of threads to run on
+ *
+ * Return:
+ *      the codec
+ *
+ * Expects:
+ *      nthreads to be positive
+ *
+ * Notes:
+ *      Memory is allocated for the codec, it is freed by codec_free
+ ************************/
+codec codec_new(unsigned width, unsigned height, unsigned nthreads)
+{
+        assert(nthreads > 0);
+        scratch s = scratch_new();
+        codec c = scratch_calloc(s, 1, sizeof(*c));
+        c->s = s;
+        c->width_in_blocks = width / 2;
+        c->height_in_blocks = height / 2;
+
+        size_t blocks = (size_t)c->width_in_blocks * c->height_in_blocks;
+        c->stride = 2 * c->width_in_blocks + 1;
+        c->pixels = scratch_alloc(s, (2 * (size_t)c->height_in_blocks + 1) *
+                                     c->stride * sizeof(struct rgb16));
+        c->words = scratch_alloc(s, blocks * sizeof(uint32_t));
+        c->bytes = scratch_alloc(s, 4 * blocks);
+        c->raster = scratch_alloc(s, 12 * blocks);
+
+        c->nranges = count_ranges(c->height_in_blocks, nthreads);
+        c->ranges = scratch_calloc(s, c->nranges, sizeof(struct range));
+        for (unsigned i = 0; i < c->nranges; i++) {
+                struct range *range = &c->ranges[i];
+                range->c = c;
+                range->first_row = (uint64_t)c->height_in_blocks * i /
+                                   c->nranges;
+                range->last_row = (uint64_t)c->height_in_blocks * (i + 1) /
+                                  c->nranges;
+        }
+
+        c->workers = nthreads > 1 ? pool_new(nthreads) : NULL;
+        chroma_thresholds();
+        dequant_tables();
+        return c;
+}
+
+/********** codec_free ********
+ *
+ * Stops a codec's threads and frees it with all of its buffers
+ *
+ * Inputs:
+ *      codec *c: pointer to the codec, set to NULL
+ *
+ * Expects:
+ *      c and *c to not be null
+ ************************/
+void codec_free(codec *c)
+{
+        assert(c && *c);
+        if ((*c)->workers != NULL) {
+                pool_free(&(*c)->workers);
+        }
+        scratch s = (*c)->s;
+        scratch_free(&s);
+        *c = NULL;
+}
+
+/********** codec_fits ********
+ *
+ * Tells whether a codec can handle an image of a given size
+ *
+ * Inputs:
+ *      codec c:                the codec
+ *      unsigned width, height: the size of a full-color or compressed
+ *                              image
+ *
+ * Return:
+ *      true if the image trims to the size the codec was made for
+ ************************/
+bool codec_fits(codec c, unsigned width, unsigned height)
+{
+        assert(c);
+        return width / 2 == c->width_in_blocks &&
+               height / 2 == c->height_in_blocks;
+}
+
+/********** run_ranges ********
+ *
+ * Runs a job once for every range of a codec and waits for them all
+ *
+ * Inputs:
+ *      codec c:        the codec
+ *      pool_job job:   called with a struct range * for every range
+ *
+ * Notes:
+ *      The ranges are run one after another when the codec has no workers
+ ************************/
+static void run_ranges(codec c, pool_job job)
+{
+        for (unsigned i = 0; i < c->nranges; i++) {
+                if (c->workers != NULL) {
+                        pool_submit(c->workers, job, &c->ranges[i]);
+                } else {
+                        job(&c->ranges[i]);
+                }
+        }
+        if (c->workers != NULL) {
+                pool_wait(c->workers);
+        }
+}
+
+/********** encode_range ********
+ *
+ * Computes and lays out the code words for a range of rows of blocks
+ *
+ * Inputs:
+ *      void *cl: the range
+ *
+ * Notes:
+ *      Touches only the range's own rows of pixels, words and bytes
+ ************************/
+static void encode_range(void *cl)
+{
+        struct range *range = cl;
+        codec c = range->c;
+        unsigned wib = c->width_in_blocks;
+        struct stats_clock clock;
+        stats_start(&clock);
+
+        for (unsigned row = range->first_row; row < range->last_row; row++) {
+                size_t first = 2 * (size_t)row * c->stride;
+                uint32_t *words = c->words + (size_t)row * wib;
+                if (c->narrow) {
+                        const struct rgb8 *top =
+                                (const struct rgb8 *)c->pixels + first;
+                        encode_block_row8(top, top + c->stride, wib,
+                                          c->denominator, words);
+                } else {
+                        const struct rgb16 *top =
+                                (const struct rgb16 *)c->pixels + first;
+                        encode_block_row(top, top + c->stride, wib,
+                                         c->denominator, words);
+                }
+                codewords_to_bytes(words, wib,
+                                   c->bytes + 4 * (size_t)row * wib);
+        }
+        stats_job_lap(STATS_CODE, &clock);
+}
+
+/********** codec_encode ********
+ *
+ * Computes the code words of one PPM image
+ *
+ * Inputs:
+ *      codec c:                the codec
+ *      ppm_reader reader:      a reader that has just read the image's
+ *                              header
+ *
+ * Return:
+ *      the code words, row by row of blocks, laid out as in the
+ *      compressed format; they stay valid until the codec is used again
+ *
+ * Expects:
+ *      the image to fit the codec
+ *
+ * Notes:
+ *      Every row of the image is read, so the reader can go on to the
+ *      next image with ppm_reader_next
+ *      A raw image with a denominator of at most 255 is read straight
+ *      into rgb8 rows and widened a span at a time by encode_block_row8
+ ************************/
+const unsigned char *codec_encode(codec c, ppm_reader reader)
+{
+        assert(c && reader);
+        assert(codec_fits(c, reader->width, reader->height));
+        c->denominator = reader->denominator;
+        c->narrow = !reader->plain && reader->denominator < 256;
+
+        struct stats_clock clock;
+        stats_start(&clock);
+        for (unsigned row = 0; row < reader->height; row++) {
+                size_t first = (size_t)row * c->stride;
+                if (c->narrow) {
+                        ppm_read_row8(reader,
+                                      (struct rgb8 *)c->pixels + first);
+                } else {
+                        ppm_read_row(reader,
+                                     (struct rgb16 *)c->pixels + first);
+                }
+        }
+        stats_lap(STATS_READ, &clock);
+        run_ranges(c, encode_range);
+        stats_wait_lap(STATS_CODE, &clock);
+
+        uint64_t blocks = (uint64_t)c->width_in_blocks * c->height_in_blocks;
+        stats_count(STATS_PIXELS, 4 * blocks);
+        stats_count(STATS_CODEWORDS, blocks);
+        return c->bytes;
+}
+
+/********** codec_compress ********
+ *
+ * Compresses one PPM image to CS40 compressed format
+ *
+ * Inputs:
+ *      codec c:                the codec
+ *      ppm_reader reader:      a reader that has just read the image's
+ *                              header
+ *      FILE *out:              the file the compressed image is written to
+ *
+ * Expects:
+ *      the image to fit the codec
+ *
+ * Notes:
+ *      Every row of the image is read, as by codec_encode
+ ************************/
+void codec_compress(codec c, ppm_reader reader, FILE *out)
+{
+        assert(out);
+        const unsigned char *bytes = codec_encode(c, reader);
+
+        struct stats_clock clock;
+        stats_start(&clock);
+        unsigned wib = c->width_in_blocks;
+        unsigned hib = c->height_in_blocks;
+        fprintf(out, "COMP40 Compressed image format 2\n%u %u\n",
+                2 * wib, 2 * hib);
+        fwrite(bytes, 4, (size_t)wib * hib, out);
+        stats_lap(STATS_WRITE, &clock);
+}
+
+/********** decode_range ********
+ *
+ * Decodes a range of rows of code words into the codec's raster
+ *
+ * Inputs:
+ *      void *cl: the range
+ *
+ * Notes:
+ *      Touches only the range's own rows of bytes, words and raster
+ ************************/
+static void decode_range(void *cl)
+{
+        struct range *range = cl;
+        codec c = range->c;
+        unsigned wib = c->width_in_blocks;
+        size_t raster_row = 6 * (size_t)wib;
+        struct stats_clock clock;
+        stats_start(&clock);
+
+        for (unsigned row = range->first_row; row < range->last_row; row++) {
+                uint32_t *words = c->words + (size_t)row * wib;
+                codewords_from_bytes(c->bytes + 4 * (size_t)row * wib, wib,
+                                     words);
+                unsigned char *top = c->raster + 2 * row * raster_row;
+                decode_block_row(words, wib, top, top + raster_row);
+        }
+        stats_job_lap(STATS_CODE, &clock);
+}
+
+/********** codec_decompress ********
+ *
+ * Decompresses one CS40 compressed image to a PPM image
+ *
+ * Inputs:
+ *      codec c:        the codec
+ *      FILE *in:       a file whose format 2 header has just been read
+ *                      by container_read_header
+ *      FILE *out:      the file the PPM image is written to
+ *
+ * Expects:
+ *      the image to fit the codec
+ ************************/
+void codec_decompress(codec c, FILE *in, FILE *out)
+{
+        assert(c && in && out);
+        unsigned wib = c->width_in_blocks;
+        unsigned hib = c->height_in_blocks;
+        size_t blocks = (size_t)wib * hib;
+
+        struct stats_clock clock;
+        stats_start(&clock);
+        size_t got = fread(c->bytes, 4, blocks, in);
+        assert(got == blocks);
+        stats_lap(STATS_READ, &clock);
+        run_ranges(c, decode_range);
+        stats_wait_lap(STATS_CODE, &clock);
+
+        ppm_write_header(out, 2 * wib, 2 * hib);
+        fwrite(c->raster, 12, blocks, out);
+        stats_lap(STATS_WRITE, &clock);
+        stats_count(STATS_PIXELS, 4 * (uint64_t)blocks);
+        stats_count(STATS_CODEWORDS, blocks);
+}
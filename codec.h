@@ -0,0 +1,35 @@
+/*******************************************************************************
+ *
+ *                                  codec.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for codec.c. A codec is made once for one
+ *      size of image and then compresses or decompresses any number of
+ *      images of that size, keeping its buffers and worker threads from
+ *      one image to the next, so each image costs only the work on its
+ *      pixels. Its output is byte for byte what compress40 and
+ *      decompress40 write.
+ *
+ ******************************************************************************/
+
+#ifndef CODEC_INCLUDED
+#define CODEC_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "ppmio.h"
+
+typedef struct codec *codec;
+
+size_t codec_size(unsigned width, unsigned height, unsigned nthreads);
+codec codec_new(unsigned width, unsigned height, unsigned nthreads);
+void codec_free(codec *c);
+bool codec_fits(codec c, unsigned width, unsigned height);
+const unsigned char *codec_encode(codec c, ppm_reader reader);
+void codec_compress(codec c, ppm_reader reader, FILE *out);
+void codec_decompress(codec c, FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ *
+ *                                  codeword.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file describes the layout of a 32 bit code word and packs and
+ *      unpacks code words with it. The layout never changes, so rather
+ *      than passing widths and offsets to the general Bitpack functions at
+ *      run time, every field's width and least significant bit is a
+ *      compile time constant and the routines below come down to a few
+ *      constant shifts and masks, with no branches and no calls.
+ *
+ *      Code words are written to the compressed file most significant
+ *      byte first. The batch routines convert whole arrays of code words
+ *      to and from that byte order.
+ *
+ ******************************************************************************/
+
+#ifndef CODEWORD_INCLUDED
+#define CODEWORD_INCLUDED
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * the fields of a code word, from the most significant end: name, width
+ * in bits, least significant bit
+ */
+#define CODEWORD_FIELDS(X)              \
+        X(A,  9, 23)                    \
+        X(B,  5, 18)                    \
+        X(C,  5, 13)                    \
+        X(D,  5,  8)                    \
+        X(PB, 4,  4)                    \
+        X(PR, 4,  0)
+
+#define CODEWORD_LAYOUT(name, width, lsb)                                   \
+        CODEWORD_##name##_WIDTH = (width),                                  \
+        CODEWORD_##name##_LSB = (lsb),
+enum { CODEWORD_FIELDS(CODEWORD_LAYOUT) };
+#undef CODEWORD_LAYOUT
+
+/* the fields must exactly fill 32 bits; this fails to compile otherwise */
+#define CODEWORD_WIDTH(name, width, lsb) + (width)
+typedef char codeword_fields_fill_32_bits
+        [(0 CODEWORD_FIELDS(CODEWORD_WIDTH)) == 32 ? 1 : -1];
+#undef CODEWORD_WIDTH
+
+#define CODEWORD_MASK(name) ((UINT32_C(1) << CODEWORD_##name##_WIDTH) - 1)
+
+/* places the low bits of value in field name */
+#define CODEWORD_PUT(name, value)                                           \
+        (((uint32_t)(value) & CODEWORD_MASK(name)) << CODEWORD_##name##_LSB)
+
+/* extracts field name of word as an unsigned or a signed value */
+#define CODEWORD_GETU(name, word)                                           \
+        (((word) >> CODEWORD_##name##_LSB) & CODEWORD_MASK(name))
+#define CODEWORD_GETS(name, word)                                           \
+        ((int32_t)((word) << (32 - CODEWORD_##name##_LSB -                  \
+                              CODEWORD_##name##_WIDTH)) >>                  \
+         (32 - CODEWORD_##name##_WIDTH))
+
+/* the fields of one code word, quantized */
+struct codeword {
+        unsigned a;
+        int b, c, d;
+        unsigned pb, pr;        /* chroma indices */
+};
+
+/********** codeword_pack ********
+ *
+ * Packs the quantized fields of a 2x2 block into a code word
+ *
+ * Inputs:
+ *      const struct codeword *fields: the quantized fields
+ *
+ * Return:
+ *      the code word
+ *
+ * Expects:
+ *      fields to not be null, every field to fit in its width; only the
+ *      low bits of a field that does not fit are kept
+ ************************/
+static inline uint32_t codeword_pack(const struct codeword *fields)
+{
+        return CODEWORD_PUT(A, fields->a) | CODEWORD_PUT(B, fields->b) |
+               CODEWORD_PUT(C, fields->c) | CODEWORD_PUT(D, fields->d) |
+               CODEWORD_PUT(PB, fields->pb) | CODEWORD_PUT(PR, fields->pr);
+}
+
+/********** codeword_unpack ********
+ *
+ * Unpacks the quantized fields of a code word
+ *
+ * Inputs:
+ *      uint32_t word:          the code word
+ *      struct codeword *fields: receives the fields
+ *
+ * Expects:
+ *      fields to not be null
+ ************************/
+static inline void codeword_unpack(uint32_t word, struct codeword *fields)
+{
+        fields->a = CODEWORD_GETU(A, word);
+        fields->b = CODEWORD_GETS(B, word);
+        fields->c = CODEWORD_GETS(C, word);
+        fields->d = CODEWORD_GETS(D, word);
+        fields->pb = CODEWORD_GETU(PB, word);
+        fields->pr = CODEWORD_GETU(PR, word);
+}
+
+/********** codewords_to_bytes ********
+ *
+ * Lays out an array of code words in the byte order of the compressed
+ * format, most significant byte first
+ *
+ * Inputs:
+ *      const uint32_t *words:  the code words
+ *      unsigned count:         the number of code words
+ *      unsigned char *bytes:   receives 4 * count bytes
+ *
+ * Expects:
+ *      No pointers to be null
+ ************************/
+static inline void codewords_to_bytes(const uint32_t *words, unsigned count,
+                                      unsigned char *bytes)
+{
+        for (unsigned i = 0; i < count; i++) {
+                uint32_t word = words[i];
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                word = __builtin_bswap32(word);
+#endif
+                memcpy(bytes + 4 * i, &word, 4);
+        }
+}
+
+/********** codewords_from_bytes ********
+ *
+ * Reads an array of code words laid out in the byte order of the
+ * compressed format, most significant byte first
+ *
+ * Inputs:
+ *      const unsigned char *bytes:     4 * count bytes of code words
+ *      unsigned count:                 the number of code words
+ *      uint32_t *words:                receives the code words
+ *
+ * Expects:
+ *      No pointers to be null
+ ************************/
+static inline void codewords_from_bytes(const unsigned char *bytes,
+                                        unsigned count, uint32_t *words)
+{
+        for (unsigned i = 0; i < count; i++) {
+                uint32_t word;
+                memcpy(&word, bytes + 4 * i, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                word = __builtin_bswap32(word);
+#endif
+                words[i] = word;
+        }
+}
+
+#endif
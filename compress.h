@@ -34,30 +34,22 @@
 #include <arith40.h>
 #include "struct_def.h"
 #include "bitpack.h"
+#include "codeword.h"
+#include "quant.h"
+#include "uarray2_ext.h"
+#include "uarray2b_ext.h"
+#include "ppmio.h"
+#include "scratch.h"
 
-Pnm_ppm read_n_trim(FILE *inputfd);
-void read_n_trim_app(int col, int row, A2Methods_UArray2 array2, void *elem, 
-                     void *cl);
-UArray2b_T rgb_to_comp_vid(Pnm_ppm original_image);
-void rgb_to_comp_vid_app(int col, int row, A2Methods_UArray2 array2, 
-                         void *elem, void *cl);
-void populate_word_info(UArray2b_T comp_vid_image, UArray2_T word_info_arr);
-void populate_word_info_app(int col, int row, A2Methods_UArray2 array2, 
-                            void *elem, void *cl);
-void pop_pb_pr(comp_vid comp_vid_pixel, meth_bundle word_info_bundle, 
-               int col, int row);
-UArray2_T init_word_info_arr(UArray2b_T comp_vid_image);
-void init_word_info_arr_app(int col, int row, A2Methods_UArray2 array2, 
-                            void *elem, void *cl);
-void pop_abcd(comp_vid comp_vid_pixel, meth_bundle word_info_bundle, 
-               int col, int row);
-void finalize_word_info(UArray2_T word_info_arr);
-void finalize_word_info_app(int col, int row, A2Methods_UArray2 array2, 
-                            void *elem, void *cl);
-int quantize_bcd(float val);
-void pack_n_print(UArray2_T word_info_arr);
-void pack_n_print_app(int col, int row, A2Methods_UArray2 array2, 
-                      void *elem, void *cl);
+meth_bundle read_n_trim(FILE *inputfd, scratch s);
+UArray2b_T rgb_to_comp_vid(meth_bundle original_image, scratch s);
+void rgb_to_comp_vid_pixel(const struct Pnm_rgb *rgb_vals, float denom,
+                           comp_vid cell);
+UArray2_T init_word_arr(UArray2b_T comp_vid_image, scratch s);
+void populate_words(UArray2b_T comp_vid_image, UArray2_T word_arr);
+void finalize_word(word_info cell);
+void print_words(UArray2_T word_arr, scratch s);
+uint64_t pack_word(word_info word_data);
 
 #endif
 
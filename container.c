@@ -0,0 +1,1004 @@
+/*******************************************************************************
+ *
+ *                                  container.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains format 3, the container described in
+ *      container.h, along with the header reader that tells it apart from
+ *      format 2. The compressor computes every code word with a codec,
+ *      codes the strips if asked to, then writes the index, whose CRCs are
+ *      taken over each strip as it will be stored, ahead of the strips
+ *      themselves. Strips are coded independently, so on more than one
+ *      thread they are coded on worker threads.
+ *
+ *      The decompressor checks the index against its own CRC and against
+ *      the image's size before trusting any offset in it, then checks each
+ *      strip's CRC before decoding it. On one thread strips are read and
+ *      written one at a time, so memory holds one strip. On more, the
+ *      strips are split into ranges decoded on worker threads straight
+ *      into the output raster; the index gives every strip's offset, so
+ *      each thread preads its own strips when the input is a regular file.
+ *      A file cut short or failing a check is reported and the
+ *      decompressor returns false, leaving it to the caller to exit or,
+ *      in batch mode, to fail just that file.
+ *
+ *      A container reader hands back the code words of any row of blocks,
+ *      reading, checking and decoding just the strip that holds it, for
+ *      the decompressors of rectangles and thumbnails.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "assert.h"
+#include "codeword.h"
+#include "crc32c.h"
+#include "rans.h"
+#include "stream.h"
+#include "codec.h"
+#include "pool.h"
+#include "scratch.h"
+#include "stats.h"
+#include "container.h"
+
+/* bytes of one index entry: offset, size and CRC */
+#define INDEX_ENTRY_BYTES 16
+
+/* ranges of strips handed out per thread, for balance */
+#define RANGES_PER_THREAD 4
+
+static const char *coding_names[] = {
+        [CODING_RAW] = "raw",
+        [CODING_RANS] = "rans",
+};
+
+#define NCODINGS (sizeof(coding_names) / sizeof(coding_names[0]))
+
+struct strip {
+        uint64_t offset;                /* from the first strip */
+        uint32_t size;
+        uint32_t crc;
+        unsigned first_row, rows;       /* rows of blocks */
+};
+
+struct range {
+        const struct comp40_header *header;
+        const struct strip *strips;
+        unsigned first, last;           /* strips, half open */
+        int fd;                         /* file to pread from, or -1 */
+        off_t offset;                   /* file offset of the first strip */
+        const unsigned char *data;      /* the strips in memory, or NULL */
+        unsigned char *buffer;          /* room for the largest strip */
+        uint32_t *words;                /* room for a strip's code words */
+        struct rans_decoder *decoder;   /* for the rans coding, or NULL */
+        unsigned char *raster;          /* the whole output raster */
+        bool failed;                    /* set if a strip fails a check */
+};
+
+struct container_reader {
+        scratch s;                      /* everything below comes from it */
+        FILE *in;
+        struct comp40_header header;
+        struct strip *strips;
+        unsigned nstrips;
+        int fd;                         /* file to pread from, or -1 */
+        off_t offset;                   /* file offset of the first strip */
+        unsigned next;                  /* strip to read through next */
+        unsigned loaded;                /* strip in words, or nstrips */
+        unsigned char *buffer;          /* room for the largest strip */
+        uint32_t *words;                /* room for a strip's code words */
+        struct rans_decoder *decoder;   /* for the rans coding, or NULL */
+};
+
+struct coder {
+        const unsigned char *bytes;     /* every strip, raw */
+        unsigned char *coded;           /* receives every strip, coded */
+        struct strip *strips;
+        unsigned first, last;           /* strips, half open */
+        unsigned width_in_blocks;
+        uint32_t *words;                /* room for a strip's code words */
+        struct rans_encoder *encoder;
+};
+
+/********** put_be ********
+ *
+ * Lays out an unsigned number most significant byte first
+ *
+ * Inputs:
+ *      unsigned char *bytes:   receives the number
+ *      uint64_t value:         the number
+ *      int size:               the number of bytes to fill
+ ************************/
+static void put_be(unsigned char *bytes, uint64_t value, int size)
+{
+        for (int i = size - 1; i >= 0; i--) {
+                bytes[i] = value & 0xff;
+                value >>= 8;
+        }
+}
+
+/********** get_be ********
+ *
+ * Reads an unsigned number laid out most significant byte first
+ *
+ * Inputs:
+ *      const unsigned char *bytes:     the number
+ *      int size:                       the number of bytes it fills
+ *
+ * Return:
+ *      the number
+ ************************/
+static uint64_t get_be(const unsigned char *bytes, int size)
+{
+        uint64_t value = 0;
+        for (int i = 0; i < size; i++) {
+                value = value << 8 | bytes[i];
+        }
+        return value;
+}
+
+/********** corrupt ********
+ *
+ * Reports a compressed image that fails a check
+ *
+ * Inputs:
+ *      const char *check:      the check that failed, a format with one %u
+ *      unsigned which:         the strip or index entry that failed it
+ *
+ * Return:
+ *      false, for the caller to return
+ ************************/
+__attribute__((format(printf, 1, 0)))
+static bool corrupt(const char *check, unsigned which)
+{
+        /* worker threads may report at once; keep each report whole */
+        flockfile(stderr);
+        fprintf(stderr, "COMP40 format 3: ");
+        fprintf(stderr, check, which);
+        fprintf(stderr, "\n");
+        funlockfile(stderr);
+        return false;
+}
+
+/********** container_parse_header ********
+ *
+ * Reads the header of a compressed image in either format, without
+ * asserting
+ *
+ * Inputs:
+ *      FILE *fp:                       the file being read
+ *      struct comp40_header *header:   receives the header
+ *
+ * Return:
+ *      HEADER_OK if a header was read, HEADER_EOF if the file was at its
+ *      end, and HEADER_BAD if anything else was there
+ *
+ * Notes:
+ *      The file is left at the first code word for format 2, and at the
+ *      index for format 3
+ ************************/
+header_status container_parse_header(FILE *fp, struct comp40_header *header)
+{
+        assert(fp && header);
+        int c = getc(fp);
+        if (c == EOF) {
+                return HEADER_EOF;
+        }
+        ungetc(c, fp);
+
+        int read = fscanf(fp, "COMP40 Compressed image format %u\n%u %u",
+                          &header->version, &header->width,
+                          &header->height);
+        if (read != 3 || (header->version != 2 && header->version != 3)) {
+                return HEADER_BAD;
+        }
+        if (header->version == 3) {
+                char name[16];
+                read = fscanf(fp, " %u %15s", &header->strip_rows, name);
+                if (read != 2 || header->strip_rows == 0) {
+                        return HEADER_BAD;
+                }
+                for (header->coding = 0; header->coding < NCODINGS &&
+                     strcmp(name, coding_names[header->coding]) != 0;
+                     header->coding++) {
+                }
+                if (header->coding == NCODINGS) {
+                        return HEADER_BAD;
+                }
+        }
+        return getc(fp) == '\n' ? HEADER_OK : HEADER_BAD;
+}
+
+/********** container_read_header ********
+ *
+ * Reads the header of a compressed image in either format
+ *
+ * Inputs:
+ *      FILE *fp:                       the file being read
+ *      struct comp40_header *header:   receives the header
+ *
+ * Return:
+ *      true if a header was read; false if the file was at its end
+ *
+ * Notes:
+ *      Anything other than a header or the end of the file is a checked
+ *      runtime error
+ *      The file is left as container_parse_header leaves it
+ ************************/
+bool container_read_header(FILE *fp, struct comp40_header *header)
+{
+        header_status status = container_parse_header(fp, header);
+        assert(status != HEADER_BAD);
+        return status == HEADER_OK;
+}
+
+/********** code_range ********
+ *
+ * Codes a range of strips with rANS
+ *
+ * Inputs:
+ *      void *cl: the range, a struct coder
+ *
+ * Notes:
+ *      Run on a worker thread; each strip is coded into the space its raw
+ *      bytes would take plus one byte per strip before it, and its entry
+ *      is updated to that offset and the coded size
+ ************************/
+static void code_range(void *cl)
+{
+        struct coder *coder = cl;
+        struct stats_clock clock;
+        stats_start(&clock);
+        for (unsigned i = coder->first; i < coder->last; i++) {
+                struct strip *strip = &coder->strips[i];
+                unsigned count = strip->rows * coder->width_in_blocks;
+                codewords_from_bytes(coder->bytes + strip->offset, count,
+                                     coder->words);
+                strip->offset += i;
+                strip->size = rans_encode(coder->encoder, coder->words, count,
+                                          coder->coded + strip->offset);
+        }
+        stats_job_lap(STATS_CODE, &clock);
+}
+
+/********** code_strips ********
+ *
+ * Codes every strip of an image with rANS
+ *
+ * Inputs:
+ *      const unsigned char *bytes:     the code words, laid out as in
+ *                                      format 2
+ *      unsigned width_in_blocks:       the width of the image in blocks
+ *      struct strip *strips:           the strips, with their raw offsets
+ *                                      and sizes; receives the offsets and
+ *                                      sizes of the coded strips
+ *      unsigned nstrips:               the number of strips
+ *      unsigned nthreads:              the number of threads to use
+ *      scratch s:                      the scratch buffers come from
+ *
+ * Return:
+ *      the coded strips
+ *
+ * Notes:
+ *      Every range's buffers are allocated on this thread, before the
+ *      range is handed to a worker
+ ************************/
+static unsigned char *code_strips(const unsigned char *bytes,
+                                  unsigned width_in_blocks,
+                                  struct strip *strips, unsigned nstrips,
+                                  unsigned nthreads, scratch s)
+{
+        size_t raw_bytes = 0;
+        for (unsigned i = 0; i < nstrips; i++) {
+                raw_bytes += strips[i].size;
+        }
+        unsigned char *coded = scratch_alloc(s, raw_bytes + nstrips);
+        size_t strip_words = nstrips > 0 ? strips[0].size / 4 : 0;
+
+        unsigned nranges = nthreads > 1 ? nthreads * RANGES_PER_THREAD : 1;
+        if (nranges > nstrips) {
+                nranges = nstrips;
+        }
+        struct coder *coders = scratch_calloc(s, nranges, sizeof(*coders));
+        pool workers = nranges > 1 ? pool_new(nthreads) : NULL;
+        for (unsigned i = 0; i < nranges; i++) {
+                struct coder *coder = &coders[i];
+                coder->bytes = bytes;
+                coder->coded = coded;
+                coder->strips = strips;
+                coder->first = (uint64_t)nstrips * i / nranges;
+                coder->last = (uint64_t)nstrips * (i + 1) / nranges;
+                coder->width_in_blocks = width_in_blocks;
+                coder->words = scratch_alloc(s, strip_words *
+                                                sizeof(uint32_t));
+                coder->encoder = scratch_alloc(s, sizeof(*coder->encoder));
+                if (workers != NULL) {
+                        pool_submit(workers, code_range, coder);
+                } else {
+                        code_range(coder);
+                }
+        }
+        if (workers != NULL) {
+                pool_wait(workers);
+                pool_free(&workers);
+        }
+        return coded;
+}
+
+/********** container_write ********
+ *
+ * Writes the code words of an image in format 3
+ *
+ * Inputs:
+ *      FILE *out:                      the file written to
+ *      unsigned width_in_blocks:       the size of the image in blocks
+ *      unsigned height_in_blocks:
+ *      const unsigned char *bytes:     the code words, row by row of
+ *                                      blocks, laid out as in format 2
+ *      coding coding:                  how the strips are stored
+ *      unsigned nthreads:              the number of threads to code on
+ *
+ * Expects:
+ *      nthreads to be positive
+ *
+ * Notes:
+ *      Strips have CONTAINER_STRIP_ROWS rows of blocks, except perhaps the
+ *      last; the index and coded strips are allocated from a scratch,
+ *      freed at the end
+ ************************/
+void container_write(FILE *out, unsigned width_in_blocks,
+                     unsigned height_in_blocks, const unsigned char *bytes,
+                     coding coding, unsigned nthreads)
+{
+        assert(out && bytes && coding < NCODINGS && nthreads > 0);
+        unsigned nstrips = (height_in_blocks + CONTAINER_STRIP_ROWS - 1) /
+                           CONTAINER_STRIP_ROWS;
+        size_t row_bytes = 4 * (size_t)width_in_blocks;
+        assert(row_bytes * CONTAINER_STRIP_ROWS < UINT32_MAX);
+
+        scratch s = scratch_new();
+        struct strip *strips = scratch_calloc(s, nstrips, sizeof(*strips));
+        uint64_t offset = 0;
+        for (unsigned i = 0; i < nstrips; i++) {
+                strips[i].rows = height_in_blocks - i * CONTAINER_STRIP_ROWS;
+                if (strips[i].rows > CONTAINER_STRIP_ROWS) {
+                        strips[i].rows = CONTAINER_STRIP_ROWS;
+                }
+                strips[i].offset = offset;
+                strips[i].size = strips[i].rows * row_bytes;
+                offset += strips[i].size;
+        }
+
+        /* from here on a strip's offset is where its bytes are in data */
+        struct stats_clock clock;
+        stats_start(&clock);
+        const unsigned char *data = bytes;
+        if (coding == CODING_RANS) {
+                data = code_strips(bytes, width_in_blocks, strips, nstrips,
+                                   nthreads, s);
+                stats_wait_lap(STATS_CODE, &clock);
+        }
+
+        size_t index_bytes = (size_t)nstrips * INDEX_ENTRY_BYTES;
+        unsigned char *index = scratch_alloc(s, index_bytes + 4);
+        offset = 0;
+        for (unsigned i = 0; i < nstrips; i++) {
+                const unsigned char *strip = data + strips[i].offset;
+                unsigned char *entry = index + i * INDEX_ENTRY_BYTES;
+                put_be(entry, offset, 8);
+                put_be(entry + 8, strips[i].size, 4);
+                put_be(entry + 12, crc32c(0, strip, strips[i].size), 4);
+                offset += strips[i].size;
+        }
+        put_be(index + index_bytes, crc32c(0, index, index_bytes), 4);
+
+        fprintf(out, "COMP40 Compressed image format 3\n%u %u\n%u %s\n",
+                2 * width_in_blocks, 2 * height_in_blocks,
+                CONTAINER_STRIP_ROWS, coding_names[coding]);
+        fwrite(index, 1, index_bytes + 4, out);
+        for (unsigned i = 0; i < nstrips; i++) {
+                fwrite(data + strips[i].offset, 1, strips[i].size, out);
+        }
+        stats_lap(STATS_WRITE, &clock);
+
+        scratch_free(&s);
+}
+
+/********** read_index ********
+ *
+ * Reads and checks the index of a format 3 image
+ *
+ * Inputs:
+ *      FILE *in:                       a file just past the header
+ *      const struct comp40_header *h:  the header
+ *      scratch s:                      the scratch the strips come from
+ *      unsigned *nstrips:              receives the number of strips
+ *
+ * Return:
+ *      the strips, with offsets, sizes and CRCs from the index, or NULL
+ *      if the index is cut short, fails its CRC, or has strips out of
+ *      order or the wrong size for their rows, which is reported
+ *
+ * Notes:
+ *      A coded strip may be no larger than its raw bytes and a mode byte
+ ************************/
+static struct strip *read_index(FILE *in, const struct comp40_header *h,
+                                scratch s, unsigned *nstrips)
+{
+        unsigned height_in_blocks = h->height / 2;
+        size_t row_bytes = 4 * (size_t)(h->width / 2);
+        unsigned n = height_in_blocks / h->strip_rows +
+                     (height_in_blocks % h->strip_rows != 0);
+
+        size_t index_bytes = (size_t)n * INDEX_ENTRY_BYTES;
+        unsigned char *index = scratch_alloc(s, index_bytes + 4);
+        size_t got = fread(index, 1, index_bytes + 4, in);
+        if (got != index_bytes + 4) {
+                corrupt("the file ends inside the index of %u strips", n);
+                return NULL;
+        }
+        if (crc32c(0, index, index_bytes) !=
+            get_be(index + index_bytes, 4)) {
+                corrupt("the index of %u strips fails its checksum", n);
+                return NULL;
+        }
+
+        struct strip *strips = scratch_calloc(s, n, sizeof(*strips));
+        uint64_t offset = 0;
+        for (unsigned i = 0; i < n; i++) {
+                const unsigned char *entry = index + i * INDEX_ENTRY_BYTES;
+                struct strip *strip = &strips[i];
+                strip->offset = get_be(entry, 8);
+                strip->size = get_be(entry + 8, 4);
+                strip->crc = get_be(entry + 12, 4);
+                strip->first_row = i * h->strip_rows;
+                strip->rows = height_in_blocks - strip->first_row;
+                if (strip->rows > h->strip_rows) {
+                        strip->rows = h->strip_rows;
+                }
+                size_t raw_size = strip->rows * row_bytes;
+                bool sized = h->coding == CODING_RAW
+                             ? strip->size == raw_size
+                             : strip->size > 0 &&
+                               strip->size <= RANS_BOUND(raw_size / 4);
+                if (strip->offset != offset || !sized) {
+                        corrupt("index entry %u does not match the image",
+                                i);
+                        return NULL;
+                }
+                offset += strip->size;
+        }
+
+        *nstrips = n;
+        return strips;
+}
+
+/********** check_strip ********
+ *
+ * Checks one strip and, if it is coded with rANS, decodes its code words
+ *
+ * Inputs:
+ *      const struct strip *strip:      the strip's index entry
+ *      unsigned which:                 the strip's number, for reports
+ *      const unsigned char *data:      the strip's bytes
+ *      unsigned width_in_blocks:       the width of the image in blocks
+ *      uint32_t *words:                receives the strip's code words if
+ *                                      decoder is not NULL
+ *      struct rans_decoder *decoder:   for a strip coded with rANS; NULL
+ *                                      for a raw strip
+ *
+ * Return:
+ *      false if the strip fails its CRC or does not decode, which is
+ *      reported
+ ************************/
+static bool check_strip(const struct strip *strip, unsigned which,
+                        const unsigned char *data, unsigned width_in_blocks,
+                        uint32_t *words, struct rans_decoder *decoder)
+{
+        if (crc32c(0, data, strip->size) != strip->crc) {
+                return corrupt("strip %u fails its checksum", which);
+        }
+        size_t count = (size_t)strip->rows * width_in_blocks;
+        if (decoder != NULL && !rans_decode(decoder, data, strip->size,
+                                            words, count)) {
+                return corrupt("strip %u does not decode", which);
+        }
+        return true;
+}
+
+/********** decode_strip ********
+ *
+ * Checks one strip and decodes it into rows of pixels
+ *
+ * Inputs:
+ *      const struct strip *strip:      the strip's index entry
+ *      unsigned which:                 the strip's number, for reports
+ *      const unsigned char *data:      the strip's bytes
+ *      unsigned width_in_blocks:       the width of the image in blocks
+ *      uint32_t *words:                room for the strip's code words
+ *      struct rans_decoder *decoder:   for a strip coded with rANS; NULL
+ *                                      for a raw strip, when words need
+ *                                      only hold one row
+ *      unsigned char *raster:          receives the strip's rows of
+ *                                      pixels, 3 bytes per pixel
+ *
+ * Return:
+ *      false if the strip fails its CRC or does not decode, which is
+ *      reported
+ ************************/
+static bool decode_strip(const struct strip *strip, unsigned which,
+                         const unsigned char *data, unsigned width_in_blocks,
+                         uint32_t *words, struct rans_decoder *decoder,
+                         unsigned char *raster)
+{
+        if (!check_strip(strip, which, data, width_in_blocks, words,
+                         decoder)) {
+                return false;
+        }
+
+        size_t row_bytes = 4 * (size_t)width_in_blocks;
+        size_t raster_row = 6 * (size_t)width_in_blocks;
+        for (unsigned row = 0; row < strip->rows; row++) {
+                const uint32_t *row_words = words;
+                if (decoder != NULL) {
+                        row_words += row * (size_t)width_in_blocks;
+                } else {
+                        codewords_from_bytes(data + row * row_bytes,
+                                             width_in_blocks, words);
+                }
+                unsigned char *top = raster + 2 * row * raster_row;
+                decode_block_row(row_words, width_in_blocks, top,
+                                 top + raster_row);
+        }
+        return true;
+}
+
+/********** strip_buffers ********
+ *
+ * Allocates what decoding one strip at a time needs
+ *
+ * Inputs:
+ *      const struct comp40_header *h:  the header
+ *      const struct strip *strips:     the index
+ *      unsigned nstrips:               the number of strips
+ *      scratch s:                      the scratch buffers come from
+ *      bool buffer:                    whether to allocate room for the
+ *                                      largest strip's bytes
+ *      struct range *range:            receives the buffers
+ ************************/
+static void strip_buffers(const struct comp40_header *h,
+                          const struct strip *strips, unsigned nstrips,
+                          scratch s, bool buffer, struct range *range)
+{
+        size_t largest = 0;
+        for (unsigned i = 0; buffer && i < nstrips; i++) {
+                largest = strips[i].size > largest ? strips[i].size : largest;
+        }
+        range->buffer = buffer ? scratch_alloc(s, largest) : NULL;
+
+        /* no strip has more rows than the first */
+        size_t words = h->width / 2;
+        range->decoder = NULL;
+        if (h->coding == CODING_RANS) {
+                words *= nstrips > 0 ? strips[0].rows : 0;
+                range->decoder = scratch_alloc(s, sizeof(*range->decoder));
+        }
+        range->words = scratch_alloc(s, words * sizeof(uint32_t));
+}
+
+/********** decode_range ********
+ *
+ * Checks and decodes a range of strips into the output raster
+ *
+ * Inputs:
+ *      void *cl: the range
+ *
+ * Notes:
+ *      Run on a worker thread; reads only its own strips and writes only
+ *      their rows of the raster
+ *      Stops at the first strip that is cut short or fails a check, and
+ *      marks the range failed
+ ************************/
+static void decode_range(void *cl)
+{
+        struct range *range = cl;
+        unsigned width_in_blocks = range->header->width / 2;
+        size_t raster_row = 6 * (size_t)width_in_blocks;
+        struct stats_clock clock;
+        stats_start(&clock);
+
+        for (unsigned i = range->first; i < range->last; i++) {
+                const struct strip *strip = &range->strips[i];
+                const unsigned char *data;
+                if (range->data != NULL) {
+                        data = range->data + strip->offset;
+                } else {
+                        ssize_t got = pread(range->fd, range->buffer,
+                                            strip->size,
+                                            range->offset + strip->offset);
+                        if (got != (ssize_t)strip->size) {
+                                range->failed = !corrupt("the file ends "
+                                                         "inside strip %u",
+                                                         i);
+                                break;
+                        }
+                        data = range->buffer;
+                }
+                unsigned char *top = range->raster + 2 * strip->first_row *
+                                                     raster_row;
+                if (!decode_strip(strip, i, data, width_in_blocks,
+                                  range->words, range->decoder, top)) {
+                        range->failed = true;
+                        break;
+                }
+        }
+        stats_job_lap(STATS_CODE, &clock);
+}
+
+/********** decompress_serial ********
+ *
+ * Decodes the strips of a format 3 image one at a time, writing each as
+ * soon as it is decoded
+ *
+ * Inputs:
+ *      FILE *in:                       a file just past the index
+ *      const struct comp40_header *h:  the header
+ *      const struct strip *strips:     the index
+ *      unsigned nstrips:               the number of strips
+ *      scratch s:                      the scratch buffers come from
+ *      FILE *out:                      the file the pixels are written to
+ *
+ * Return:
+ *      false if a strip is cut short or fails a check, which is reported;
+ *      the strips before it have been written
+ ************************/
+static bool decompress_serial(FILE *in, const struct comp40_header *h,
+                              const struct strip *strips, unsigned nstrips,
+                              scratch s, FILE *out)
+{
+        unsigned width_in_blocks = h->width / 2;
+        struct range range;
+        strip_buffers(h, strips, nstrips, s, true, &range);
+        size_t strip_blocks = nstrips > 0 ? strips[0].rows *
+                                            (size_t)width_in_blocks : 0;
+        unsigned char *raster = scratch_alloc(s, 12 * strip_blocks);
+
+        struct stats_clock clock;
+        stats_start(&clock);
+        for (unsigned i = 0; i < nstrips; i++) {
+                size_t got = fread(range.buffer, 1, strips[i].size, in);
+                if (got != strips[i].size) {
+                        return corrupt("the file ends inside strip %u", i);
+                }
+                stats_lap(STATS_READ, &clock);
+                if (!decode_strip(&strips[i], i, range.buffer,
+                                  width_in_blocks, range.words,
+                                  range.decoder, raster)) {
+                        return false;
+                }
+                stats_lap(STATS_CODE, &clock);
+                fwrite(raster, 12 * (size_t)width_in_blocks,
+                       strips[i].rows, out);
+                stats_lap(STATS_WRITE, &clock);
+        }
+        return true;
+}
+
+/********** decompress_parallel ********
+ *
+ * Decodes the strips of a format 3 image on worker threads into one
+ * raster and writes it
+ *
+ * Inputs:
+ *      FILE *in:                       a file just past the index
+ *      const struct comp40_header *h:  the header
+ *      const struct strip *strips:     the index
+ *      unsigned nstrips:               the number of strips
+ *      unsigned nthreads:              the number of worker threads
+ *      scratch s:                      the scratch buffers come from
+ *      FILE *out:                      the file the pixels are written to
+ *
+ * Return:
+ *      false if a strip is cut short or fails a check, which is reported;
+ *      nothing is written then
+ *
+ * Notes:
+ *      Every range's buffers are allocated on this thread, before the
+ *      range is handed to a worker
+ *      A file read in place is left just past the last strip, as one
+ *      that is slurped is, so another image may follow it
+ ************************/
+static bool decompress_parallel(FILE *in, const struct comp40_header *h,
+                                const struct strip *strips, unsigned nstrips,
+                                unsigned nthreads, scratch s, FILE *out)
+{
+        unsigned width_in_blocks = h->width / 2;
+        size_t blocks = (size_t)width_in_blocks * (h->height / 2);
+        unsigned char *raster = scratch_alloc(s, 12 * blocks);
+
+        struct stats_clock clock;
+        stats_start(&clock);
+        /* regular files are read in place; anything else is slurped */
+        struct stat info;
+        int fd = fileno(in);
+        off_t offset = ftello(in);
+        const unsigned char *data = NULL;
+        size_t size = nstrips > 0 ? strips[nstrips - 1].offset +
+                                    strips[nstrips - 1].size : 0;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || offset < 0) {
+                unsigned char *bytes = scratch_alloc(s, size);
+                size_t got = fread(bytes, 1, size, in);
+                if (got != size) {
+                        unsigned i = 0;
+                        while (strips[i].offset + strips[i].size <= got) {
+                                i++;
+                        }
+                        return corrupt("the file ends inside strip %u", i);
+                }
+                data = bytes;
+                fd = -1;
+        }
+        stats_lap(STATS_READ, &clock);
+
+        unsigned nranges = nthreads * RANGES_PER_THREAD;
+        if (nranges > nstrips) {
+                nranges = nstrips;
+        }
+        struct range *ranges = scratch_calloc(s, nranges, sizeof(*ranges));
+        pool workers = pool_new(nthreads);
+        for (unsigned i = 0; i < nranges; i++) {
+                struct range *range = &ranges[i];
+                range->header = h;
+                range->strips = strips;
+                range->first = (uint64_t)nstrips * i / nranges;
+                range->last = (uint64_t)nstrips * (i + 1) / nranges;
+                range->fd = fd;
+                range->offset = offset;
+                range->data = data;
+                strip_buffers(h, strips, nstrips, s, data == NULL, range);
+                range->raster = raster;
+                pool_submit(workers, decode_range, range);
+        }
+        pool_wait(workers);
+        pool_free(&workers);
+        stats_wait_lap(STATS_CODE, &clock);
+        for (unsigned i = 0; i < nranges; i++) {
+                if (ranges[i].failed) {
+                        return false;
+                }
+        }
+        if (fd >= 0 && fseeko(in, offset + (off_t)size, SEEK_SET) != 0) {
+                return false;
+        }
+
+        fwrite(raster, 12, blocks, out);
+        stats_lap(STATS_WRITE, &clock);
+        return true;
+}
+
+/********** container_decompress ********
+ *
+ * Decompresses a format 3 image to a PPM image
+ *
+ * Inputs:
+ *      FILE *in:                       a file whose header has just been
+ *                                      read by container_read_header
+ *      const struct comp40_header *h:  the header
+ *      unsigned nthreads:              the number of threads to use
+ *      FILE *out:                      the file the PPM image is written to
+ *
+ * Return:
+ *      false if the file is cut short, or the index or a strip fails its
+ *      checks, which is reported on stderr as corrupt; the output may
+ *      then hold part of the image
+ *
+ * Expects:
+ *      h to be a format 3 header, nthreads to be positive
+ *
+ * Notes:
+ *      Writes exactly what decompress40 writes for the same code words in
+ *      format 2
+ *      The index and buffers are allocated from a scratch, freed at the
+ *      end
+ ************************/
+bool container_decompress(FILE *in, const struct comp40_header *h,
+                          unsigned nthreads, FILE *out)
+{
+        assert(in && h && out && nthreads > 0);
+        assert(h->version == 3);
+        scratch s = scratch_new();
+
+        unsigned nstrips;
+        struct strip *strips = read_index(in, h, s, &nstrips);
+        bool ok = strips != NULL;
+        if (ok) {
+                ppm_write_header(out, 2 * (h->width / 2),
+                                 2 * (h->height / 2));
+                ok = nthreads > 1
+                     ? decompress_parallel(in, h, strips, nstrips, nthreads,
+                                           s, out)
+                     : decompress_serial(in, h, strips, nstrips, s, out);
+        }
+        if (ok) {
+                uint64_t blocks = (uint64_t)(h->width / 2) * (h->height / 2);
+                stats_count(STATS_PIXELS, 4 * blocks);
+                stats_count(STATS_CODEWORDS, blocks);
+        }
+
+        scratch_free(&s);
+        return ok;
+}
+
+/********** compress40_container ********
+ *
+ * Compresses a PPM image to format 3
+ *
+ * Inputs:
+ *      FILE *fp:               pointer to a file holding a PPM image
+ *      coding coding:          how the strips are stored
+ *      unsigned nthreads:      the number of threads to use
+ *
+ * Expects:
+ *      The file to hold a properly formatted PPM image, nthreads to be
+ *      positive
+ *
+ * Notes:
+ *      Writes the compressed image to stdout; its code words are exactly
+ *      those compress40 writes
+ ************************/
+void compress40_container(FILE *fp, coding coding, unsigned nthreads)
+{
+        ppm_reader reader = ppm_reader_new(fp);
+        codec c = codec_new(reader->width, reader->height, nthreads);
+
+        const unsigned char *bytes = codec_encode(c, reader);
+        container_write(stdout, reader->width / 2, reader->height / 2,
+                        bytes, coding, nthreads);
+
+        codec_free(&c);
+        ppm_reader_free(&reader);
+}
+
+/********** container_reader_new ********
+ *
+ * Reads the index of a format 3 image and returns a reader that hands
+ * back its code words one row of blocks at a time
+ *
+ * Inputs:
+ *      FILE *in:                       a file whose header has just been
+ *                                      read by container_read_header
+ *      const struct comp40_header *h:  the header
+ *
+ * Return:
+ *      the reader, or NULL if the index is cut short or fails its checks,
+ *      which is reported
+ *
+ * Expects:
+ *      h to be a format 3 header
+ *
+ * Notes:
+ *      The reader and its buffers, room for the largest strip and for
+ *      one strip's code words, are allocated from a scratch, freed by
+ *      container_reader_free
+ ************************/
+container_reader container_reader_new(FILE *in, const struct comp40_header *h)
+{
+        assert(in && h && h->version == 3);
+        scratch s = scratch_new();
+        container_reader r = scratch_calloc(s, 1, sizeof(*r));
+        r->s = s;
+        r->in = in;
+        r->header = *h;
+        r->strips = read_index(in, h, s, &r->nstrips);
+        if (r->strips == NULL) {
+                scratch_free(&s);
+                return NULL;
+        }
+
+        size_t largest = 0;
+        for (unsigned i = 0; i < r->nstrips; i++) {
+                largest = r->strips[i].size > largest ? r->strips[i].size
+                                                      : largest;
+        }
+        r->buffer = scratch_alloc(s, largest);
+        r->words = scratch_alloc(s, (size_t)h->strip_rows * (h->width / 2) *
+                                    sizeof(uint32_t));
+        if (h->coding == CODING_RANS) {
+                r->decoder = scratch_alloc(s, sizeof(*r->decoder));
+        }
+
+        /* regular files are pread in place; anything else is read through */
+        struct stat info;
+        r->fd = fileno(in);
+        r->offset = ftello(in);
+        if (fstat(r->fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+            r->offset < 0) {
+                r->fd = -1;
+        }
+        r->loaded = r->nstrips;
+        return r;
+}
+
+/********** container_reader_row ********
+ *
+ * Finds the code words of one row of blocks
+ *
+ * Inputs:
+ *      container_reader r:     the reader
+ *      unsigned row:           the row of blocks
+ *
+ * Return:
+ *      the row's code words, valid until the next call, or NULL if its
+ *      strip is cut short or fails a check, which is reported
+ *
+ * Expects:
+ *      row to be inside the image, and, when the file is not a regular
+ *      file, no lower than any row asked for before
+ *
+ * Notes:
+ *      The whole strip holding the row is read, checked and decoded the
+ *      first time one of its rows is asked for; strips above it are
+ *      skipped with pread, or read and dropped from anything else
+ ************************/
+const uint32_t *container_reader_row(container_reader r, unsigned row)
+{
+        assert(r && row < r->header.height / 2);
+        unsigned width_in_blocks = r->header.width / 2;
+        unsigned which = row / r->header.strip_rows;
+        const struct strip *strip = &r->strips[which];
+
+        if (which != r->loaded) {
+                if (r->fd >= 0) {
+                        ssize_t got = pread(r->fd, r->buffer, strip->size,
+                                            r->offset + strip->offset);
+                        if (got != (ssize_t)strip->size) {
+                                corrupt("the file ends inside strip %u",
+                                        which);
+                                return NULL;
+                        }
+                } else {
+                        assert(which >= r->next);
+                        for (; r->next <= which; r->next++) {
+                                size_t size = r->strips[r->next].size;
+                                if (fread(r->buffer, 1, size, r->in) !=
+                                    size) {
+                                        corrupt("the file ends inside strip "
+                                                "%u", r->next);
+                                        return NULL;
+                                }
+                        }
+                }
+                if (!check_strip(strip, which, r->buffer, width_in_blocks,
+                                 r->words, r->decoder)) {
+                        return NULL;
+                }
+                if (r->decoder == NULL) {
+                        codewords_from_bytes(r->buffer, (size_t)strip->rows *
+                                                        width_in_blocks,
+                                             r->words);
+                }
+                r->loaded = which;
+        }
+        return r->words + (size_t)(row - strip->first_row) * width_in_blocks;
+}
+
+/********** container_reader_free ********
+ *
+ * Frees a reader made by container_reader_new
+ *
+ * Inputs:
+ *      container_reader *r: the reader, set to NULL
+ ************************/
+void container_reader_free(container_reader *r)
+{
+        assert(r && *r);
+        scratch s = (*r)->s;
+        scratch_free(&s);
+        *r = NULL;
+}
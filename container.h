@@ -0,0 +1,79 @@
+/*******************************************************************************
+ *
+ *                                  container.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for container.c. It declares the reader for
+ *      the headers of both compressed formats and the writer and decoder
+ *      for format 3, which keeps format 2's code words but cuts them into
+ *      strips of rows of blocks, with an index giving every strip's offset,
+ *      size and CRC-32C.
+ *
+ *      Format 3 is laid out as
+ *
+ *              COMP40 Compressed image format 3\n
+ *              <width> <height>\n
+ *              <rows of blocks per strip> <coding>\n
+ *              one 16 byte index entry per strip
+ *              the CRC-32C of the index, 4 bytes
+ *              the strips, one after another
+ *
+ *      An index entry is the strip's offset from the first strip (8
+ *      bytes), its size (4 bytes) and the CRC-32C of its bytes (4 bytes),
+ *      all most significant byte first. With the raw coding a strip holds
+ *      its code words exactly as format 2 lays them out; with the rans
+ *      coding it holds them as rans.c codes them.
+ *
+ ******************************************************************************/
+
+#ifndef CONTAINER_INCLUDED
+#define CONTAINER_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "ppmio.h"
+
+/* rows of blocks per strip written by container_write */
+#define CONTAINER_STRIP_ROWS 16
+
+/* how the code words of a strip are stored */
+typedef enum coding {
+        CODING_RAW,
+        CODING_RANS
+} coding;
+
+struct comp40_header {
+        unsigned version;               /* 2 or 3 */
+        unsigned width, height;
+        unsigned strip_rows;            /* format 3 only */
+        coding coding;                  /* format 3 only */
+};
+
+typedef enum header_status {
+        HEADER_OK,
+        HEADER_EOF,                     /* nothing left in the file */
+        HEADER_BAD                      /* not a compressed image */
+} header_status;
+
+header_status container_parse_header(FILE *fp, struct comp40_header *header);
+bool container_read_header(FILE *fp, struct comp40_header *header);
+void container_write(FILE *out, unsigned width_in_blocks,
+                     unsigned height_in_blocks, const unsigned char *bytes,
+                     coding coding, unsigned nthreads);
+bool container_decompress(FILE *in, const struct comp40_header *header,
+                          unsigned nthreads, FILE *out);
+void compress40_container(FILE *fp, coding coding, unsigned nthreads);
+
+/* reads the code words of a format 3 image one row of blocks at a time */
+typedef struct container_reader *container_reader;
+
+container_reader container_reader_new(FILE *in,
+                                      const struct comp40_header *header);
+const uint32_t *container_reader_row(container_reader reader, unsigned row);
+void container_reader_free(container_reader *reader);
+
+#endif
@@ -0,0 +1,443 @@
+/*******************************************************************************
+ *
+ *                                  convert.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the bulk color space conversion kernels used by
+ *      the streaming codec. rgb_to_ypbpr_span converts a span of pixels to
+ *      planar Y, Pb and Pr values using SSE2, or AVX2 when the processor
+ *      supports it, and falls back to plain C elsewhere. words_to_rgb_rows
+ *      goes the other way in one pass, from a run of code words straight to
+ *      the finished 8-bit pixels of both rows they describe.
+ *
+ *      Every version computes exactly the floats rgb_to_comp_vid_pixel
+ *      does, so the code words do not depend on which kernel ran. Likewise
+ *      the decode kernels repeat the steps of unpack_word, word_to_comp_vid
+ *      and comp_vid_to_rgb_pixel operation for operation. The
+ *      conversion constants are doubles, so the vector kernels work in
+ *      double precision lanes and round to float where the C code does.
+ *      Dividing a sample by the denominator in float gives the same result
+ *      as multiplying it by a double reciprocal and rounding to float,
+ *      because no quotient of two integers below 2^16 lies close enough to
+ *      a float rounding boundary for the reciprocal's error to matter.
+ *
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include "assert.h"
+#include "codeword.h"
+#include "quant.h"
+#include "blockrow.h"
+#include "convert.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+typedef void span_kernel(const struct rgb16 *pixels, unsigned count,
+                         double recip, float *y, float *pb, float *pr);
+typedef void words_kernel(const uint32_t *words, unsigned count,
+                          unsigned char *top, unsigned char *bottom);
+
+/* the kernels chosen for this processor, filled on first use */
+static span_kernel *span_impl;
+static words_kernel *words_impl;
+static pthread_once_t kernels_selected = PTHREAD_ONCE_INIT;
+
+/********** span_scalar ********
+ *
+ * Converts a span of pixels to component video one pixel at a time
+ *
+ * Inputs:
+ *      const struct rgb16 *pixels:     the pixels being converted
+ *      unsigned count:                 the number of pixels
+ *      double recip:                   1 over the denominator of the image
+ *      float *y, *pb, *pr:             receive count values each
+ *
+ * Expects:
+ *      No pointers to be null
+ *
+ * Notes:
+ *      Used on processors without vector kernels and for the pixels left
+ *      over at the end of a span by the vector kernels
+ ************************/
+static void span_scalar(const struct rgb16 *pixels, unsigned count,
+                        double recip, float *y, float *pb, float *pr)
+{
+        for (unsigned i = 0; i < count; i++) {
+                float r = pixels[i].red * recip;
+                float g = pixels[i].green * recip;
+                float b = pixels[i].blue * recip;
+
+                y[i] = 0.299 * r + 0.587 * g + 0.114 * b;
+                pb[i] = -0.168736 * r - 0.331264 * g + 0.5 * b;
+                pr[i] = 0.5 * r - 0.418688 * g - 0.081312 * b;
+        }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/*
+ * Each macro below mirrors one line of span_scalar on two (SSE2) or four
+ * (AVX2) lanes: samples are scaled in double, rounded to float, widened
+ * back, and the three sums are formed left to right exactly as C does.
+ */
+#define SSE2_SAMPLES(field, k)                                              \
+        _mm_cvtps_pd(_mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(             \
+                _mm_set_epi32(0, 0, (int)pixels[i + (k) + 1].field,         \
+                              (int)pixels[i + (k)].field)), scale)))
+
+/********** span_sse2 ********
+ *
+ * Converts a span of pixels to component video four pixels at a time
+ * with SSE2
+ *
+ * Inputs and expectations are the same as span_scalar's
+ ************************/
+static void span_sse2(const struct rgb16 *pixels, unsigned count,
+                      double recip, float *y, float *pb, float *pr)
+{
+        const __m128d scale = _mm_set1_pd(recip);
+        const __m128d y_r = _mm_set1_pd(0.299), y_g = _mm_set1_pd(0.587);
+        const __m128d y_b = _mm_set1_pd(0.114);
+        const __m128d pb_r = _mm_set1_pd(-0.168736);
+        const __m128d pb_g = _mm_set1_pd(0.331264);
+        const __m128d half = _mm_set1_pd(0.5);
+        const __m128d pr_g = _mm_set1_pd(0.418688);
+        const __m128d pr_b = _mm_set1_pd(0.081312);
+        unsigned i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+                __m128 yv[2], pbv[2], prv[2];
+                for (int k = 0; k < 2; k++) {
+                        __m128d r = SSE2_SAMPLES(red, 2 * k);
+                        __m128d g = SSE2_SAMPLES(green, 2 * k);
+                        __m128d b = SSE2_SAMPLES(blue, 2 * k);
+
+                        yv[k] = _mm_cvtpd_ps(_mm_add_pd(_mm_add_pd(
+                                        _mm_mul_pd(y_r, r),
+                                        _mm_mul_pd(y_g, g)),
+                                        _mm_mul_pd(y_b, b)));
+                        pbv[k] = _mm_cvtpd_ps(_mm_add_pd(_mm_sub_pd(
+                                        _mm_mul_pd(pb_r, r),
+                                        _mm_mul_pd(pb_g, g)),
+                                        _mm_mul_pd(half, b)));
+                        prv[k] = _mm_cvtpd_ps(_mm_sub_pd(_mm_sub_pd(
+                                        _mm_mul_pd(half, r),
+                                        _mm_mul_pd(pr_g, g)),
+                                        _mm_mul_pd(pr_b, b)));
+                }
+                _mm_storeu_ps(y + i, _mm_movelh_ps(yv[0], yv[1]));
+                _mm_storeu_ps(pb + i, _mm_movelh_ps(pbv[0], pbv[1]));
+                _mm_storeu_ps(pr + i, _mm_movelh_ps(prv[0], prv[1]));
+        }
+
+        span_scalar(pixels + i, count - i, recip, y + i, pb + i, pr + i);
+}
+
+#define AVX2_SAMPLES(half_of)                                               \
+        _mm256_cvtps_pd(_mm256_cvtpd_ps(_mm256_mul_pd(                     \
+                _mm256_cvtepi32_pd(half_of), scale)))
+
+/********** span_avx2 ********
+ *
+ * Converts a span of pixels to component video eight pixels at a time
+ * with AVX2
+ *
+ * Inputs and expectations are the same as span_scalar's
+ *
+ * Notes:
+ *      The samples of eight pixels are pulled out of the array of structs
+ *      with two gathers of 32 bits per pixel, one of red and green and one
+ *      of green and blue, each then split into its 16-bit halves; neither
+ *      reads past the pixel it starts in
+ ************************/
+__attribute__((target("avx2")))
+static void span_avx2(const struct rgb16 *pixels, unsigned count,
+                      double recip, float *y, float *pb, float *pr)
+{
+        const __m256d scale = _mm256_set1_pd(recip);
+        const __m256d y_r = _mm256_set1_pd(0.299);
+        const __m256d y_g = _mm256_set1_pd(0.587);
+        const __m256d y_b = _mm256_set1_pd(0.114);
+        const __m256d pb_r = _mm256_set1_pd(-0.168736);
+        const __m256d pb_g = _mm256_set1_pd(0.331264);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d pr_g = _mm256_set1_pd(0.418688);
+        const __m256d pr_b = _mm256_set1_pd(0.081312);
+        const __m256i offsets = _mm256_setr_epi32(0, 6, 12, 18, 24, 30, 36,
+                                                   42);
+        const __m256i low = _mm256_set1_epi32(0xffff);
+        unsigned i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+                const char *base = (const char *)&pixels[i];
+                __m256i red_green = _mm256_i32gather_epi32(
+                        (const int *)base, offsets, 1);
+                __m256i green_blue = _mm256_i32gather_epi32(
+                        (const int *)(base + 2), offsets, 1);
+                __m256i red = _mm256_and_si256(red_green, low);
+                __m256i green = _mm256_srli_epi32(red_green, 16);
+                __m256i blue = _mm256_srli_epi32(green_blue, 16);
+                __m128 yv[2], pbv[2], prv[2];
+
+                for (int k = 0; k < 2; k++) {
+                        __m256d r = AVX2_SAMPLES(k == 0 ?
+                                _mm256_castsi256_si128(red) :
+                                _mm256_extracti128_si256(red, 1));
+                        __m256d g = AVX2_SAMPLES(k == 0 ?
+                                _mm256_castsi256_si128(green) :
+                                _mm256_extracti128_si256(green, 1));
+                        __m256d b = AVX2_SAMPLES(k == 0 ?
+                                _mm256_castsi256_si128(blue) :
+                                _mm256_extracti128_si256(blue, 1));
+
+                        yv[k] = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_add_pd(
+                                        _mm256_mul_pd(y_r, r),
+                                        _mm256_mul_pd(y_g, g)),
+                                        _mm256_mul_pd(y_b, b)));
+                        pbv[k] = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_sub_pd(
+                                        _mm256_mul_pd(pb_r, r),
+                                        _mm256_mul_pd(pb_g, g)),
+                                        _mm256_mul_pd(half, b)));
+                        prv[k] = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_sub_pd(
+                                        _mm256_mul_pd(half, r),
+                                        _mm256_mul_pd(pr_g, g)),
+                                        _mm256_mul_pd(pr_b, b)));
+                }
+                _mm_storeu_ps(y + i, yv[0]);
+                _mm_storeu_ps(y + i + 4, yv[1]);
+                _mm_storeu_ps(pb + i, pbv[0]);
+                _mm_storeu_ps(pb + i + 4, pbv[1]);
+                _mm_storeu_ps(pr + i, prv[0]);
+                _mm_storeu_ps(pr + i + 4, prv[1]);
+        }
+
+        span_sse2(pixels + i, count - i, recip, y + i, pb + i, pr + i);
+}
+
+#endif
+
+/********** words_scalar ********
+ *
+ * Decodes a run of code words to 8-bit pixels one word at a time
+ *
+ * Inputs:
+ *      const uint32_t *words:  the code words, one per 2x2 block
+ *      unsigned count:         the number of code words
+ *      unsigned char *top:     receives 6 * count bytes of the upper row
+ *      unsigned char *bottom:  receives 6 * count bytes of the lower row
+ *
+ * Expects:
+ *      No pointers to be null
+ *
+ * Notes:
+ *      Used on processors without vector kernels and for the words left
+ *      over at the end of a run by the vector kernels
+ ************************/
+static void words_scalar(const uint32_t *words, unsigned count,
+                         unsigned char *top, unsigned char *bottom)
+{
+        for (unsigned i = 0; i < count; i++) {
+                struct word_info word;
+                struct comp_vid block[4];
+                unpack_word(words[i], &word);
+                word_to_comp_vid(&word, block);
+
+                unsigned char *out[4] = { top + 6 * i, top + 6 * i + 3,
+                                          bottom + 6 * i, bottom + 6 * i + 3 };
+                for (int k = 0; k < 4; k++) {
+                        struct Pnm_rgb pixel;
+                        comp_vid_to_rgb_pixel(&block[k], &pixel);
+                        out[k][0] = pixel.red;
+                        out[k][1] = pixel.green;
+                        out[k][2] = pixel.blue;
+                }
+        }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/*
+ * The decode kernel is written once with GCC vector types, four blocks
+ * to a vector, and compiled twice: for plain SSE2 and for AVX2, where the
+ * four double lanes fit in a single register.
+ */
+typedef int32_t v4si __attribute__((vector_size(16)));
+typedef uint32_t v4su __attribute__((vector_size(16)));
+typedef float v4sf __attribute__((vector_size(16)));
+typedef double v4df __attribute__((vector_size(32)));
+
+#define TO_FLOAT(x) __builtin_convertvector((x), v4sf)
+#define TO_DOUBLE(x) __builtin_convertvector((x), v4df)
+
+/* lanes of x greater than limit become limit (quantize_rgb's clamps) */
+#define CLAMP_ABOVE(x, limit)                                               \
+        ((v4sf)(((v4si)(x) & ~((x) > (limit))) |                          \
+                ((v4si)(limit) & ((x) > (limit)))))
+#define CLAMP_BELOW(x, limit)                                               \
+        ((v4sf)(((v4si)(x) & ~((x) < (limit))) |                          \
+                ((v4si)(limit) & ((x) < (limit)))))
+
+/* the table entries for the four lanes of a vector of field codes */
+#define LOOKUP(type, table, codes)                                          \
+        ((type){ (table)[(codes)[0]], (table)[(codes)[1]],                  \
+                 (table)[(codes)[2]], (table)[(codes)[3]] })
+
+#define WORDS_KERNEL(name, attribute)                                       \
+attribute                                                                   \
+static void name(const uint32_t *words, unsigned count,                     \
+                 unsigned char *top, unsigned char *bottom)                 \
+{                                                                           \
+        const v4sf zero = { 0, 0, 0, 0 }, one = { 1, 1, 1, 1 };             \
+        const v4sf denominator = { 255, 255, 255, 255 };                    \
+        const struct dequant_tables *tables = dequant_tables();             \
+        unsigned i = 0;                                                     \
+                                                                            \
+        for (; i + 4 <= count; i += 4) {                                    \
+                v4su w;                                                     \
+                memcpy(&w, words + i, sizeof(w));                           \
+                                                                            \
+                /* unpack_word and dequantize through the tables */        \
+                v4su a_code = CODEWORD_GETU(A, w);                          \
+                v4su b_code = CODEWORD_GETU(B, w);                          \
+                v4su c_code = CODEWORD_GETU(C, w);                          \
+                v4su d_code = CODEWORD_GETU(D, w);                          \
+                v4su pb_code = CODEWORD_GETU(PB, w);                        \
+                v4su pr_code = CODEWORD_GETU(PR, w);                        \
+                v4sf a = LOOKUP(v4sf, tables->a, a_code);                   \
+                v4sf b = LOOKUP(v4sf, tables->bcd, b_code);                 \
+                v4sf c = LOOKUP(v4sf, tables->bcd, c_code);                 \
+                v4sf d = LOOKUP(v4sf, tables->bcd, d_code);                 \
+                v4df pb = LOOKUP(v4df, tables->chroma, pb_code);            \
+                v4df pr = LOOKUP(v4df, tables->chroma, pr_code);            \
+                                                                            \
+                /* word_to_comp_vid: top left, top right, bottom left, */  \
+                /* bottom right                                         */  \
+                v4sf y[4] = { a - b - c + d, a - b + c - d,                 \
+                              a + b - c - d, a + b + c + d };               \
+                                                                            \
+                /* comp_vid_to_rgb_pixel terms shared by the 4 pixels */    \
+                v4df r_pb = 0.0 * pb, r_pr = 1.402 * pr;                    \
+                v4df g_pb = 0.344136 * pb, g_pr = 0.714136 * pr;            \
+                v4df b_pb = 1.772 * pb, b_pr = 0.0 * pr;                    \
+                                                                            \
+                for (int k = 0; k < 4; k++) {                               \
+                        v4df yk = 1.0 * TO_DOUBLE(y[k]);                    \
+                        v4sf rgb[3] = { TO_FLOAT(yk + r_pb + r_pr),         \
+                                        TO_FLOAT(yk - g_pb - g_pr),         \
+                                        TO_FLOAT(yk + b_pb + b_pr) };       \
+                        v4si q[3];                                          \
+                        for (int ch = 0; ch < 3; ch++) {                    \
+                                v4sf x = CLAMP_ABOVE(rgb[ch], one);         \
+                                x = CLAMP_BELOW(x, zero);                   \
+                                q[ch] = __builtin_convertvector(            \
+                                                x * denominator, v4si);     \
+                        }                                                   \
+                                                                            \
+                        unsigned char *row = k < 2 ? top : bottom;          \
+                        for (int lane = 0; lane < 4; lane++) {              \
+                                unsigned char *px = row +                   \
+                                        6 * (i + lane) + 3 * (k & 1);       \
+                                px[0] = q[0][lane];                         \
+                                px[1] = q[1][lane];                         \
+                                px[2] = q[2][lane];                         \
+                        }                                                   \
+                }                                                           \
+        }                                                                   \
+                                                                            \
+        words_scalar(words + i, count - i, top + 6 * i, bottom + 6 * i);    \
+}
+
+WORDS_KERNEL(words_sse2, )
+WORDS_KERNEL(words_avx2, __attribute__((target("avx2"))))
+
+#endif
+
+/********** select_kernels ********
+ *
+ * Picks the fastest kernels the processor supports
+ *
+ * Notes:
+ *      Run exactly once, through pthread_once, so that threads entering
+ *      the kernels at the same time all see the finished choice
+ ************************/
+static void select_kernels(void)
+{
+#ifdef HAVE_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+                span_impl = span_avx2;
+                words_impl = words_avx2;
+        } else {
+                span_impl = span_sse2;
+                words_impl = words_sse2;
+        }
+#else
+        span_impl = span_scalar;
+        words_impl = words_scalar;
+#endif
+}
+
+/********** rgb_to_ypbpr_span ********
+ *
+ * Converts a span of pixels from rgb to planar component video values
+ *
+ * Inputs:
+ *      const struct rgb16 *pixels:     the pixels being converted
+ *      unsigned count:                 the number of pixels
+ *      double recip:                   1.0 divided by the denominator of
+ *                                      the image
+ *      float *y, *pb, *pr:             each receive count values
+ *
+ * Expects:
+ *      No pointers to be null, samples to be at most 65535
+ *
+ * Notes:
+ *      The kernel is chosen on the first call, safely from any thread
+ *      Results are identical to calling rgb_to_comp_vid_pixel on each pixel
+ ************************/
+void rgb_to_ypbpr_span(const struct rgb16 *pixels, unsigned count,
+                       double recip, float *y, float *pb, float *pr)
+{
+        assert(pixels && y && pb && pr);
+
+        pthread_once(&kernels_selected, select_kernels);
+        span_impl(pixels, count, recip, y, pb, pr);
+}
+
+/********** words_to_rgb_rows ********
+ *
+ * Decodes a run of code words straight to the 8-bit pixels of the two
+ * rows they describe
+ *
+ * Inputs:
+ *      const uint32_t *words:  the code words, one per 2x2 block
+ *      unsigned count:         the number of code words
+ *      unsigned char *top:     receives the upper row, 3 bytes per pixel
+ *      unsigned char *bottom:  receives the lower row, 3 bytes per pixel
+ *
+ * Expects:
+ *      No pointers to be null, top and bottom to have room for 6 * count
+ *      bytes each
+ *
+ * Notes:
+ *      The kernel is chosen on the first call, safely from any thread
+ *      Results are identical to unpacking each word with unpack_word,
+ *      word_to_comp_vid and comp_vid_to_rgb_pixel, with a denominator of
+ *      255
+ ************************/
+void words_to_rgb_rows(const uint32_t *words, unsigned count,
+                       unsigned char *top, unsigned char *bottom)
+{
+        assert(words && top && bottom);
+
+        pthread_once(&kernels_selected, select_kernels);
+        words_impl(words, count, top, bottom);
+}
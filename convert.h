@@ -0,0 +1,28 @@
+/*******************************************************************************
+ *
+ *                                  convert.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for convert.c. It declares the bulk color
+ *      space conversion kernels, which convert whole spans of pixels or
+ *      runs of code words at a time with SIMD instructions where the
+ *      processor has them.
+ *
+ ******************************************************************************/
+
+#ifndef CONVERT_INCLUDED
+#define CONVERT_INCLUDED
+
+#include <stdint.h>
+#include <pnm.h>
+#include "struct_def.h"
+
+void rgb_to_ypbpr_span(const struct rgb16 *pixels, unsigned count,
+                       double recip, float *y, float *pb, float *pr);
+void words_to_rgb_rows(const uint32_t *words, unsigned count,
+                       unsigned char *top, unsigned char *bottom);
+
+#endif
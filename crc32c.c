@@ -0,0 +1,138 @@
+/*******************************************************************************
+ *
+ *                                  crc32c.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the CRC-32C checksum, the reflected CRC with the
+ *      Castagnoli polynomial 0x82f63b78 that iSCSI and ext4 use. Processors
+ *      with SSE4.2 compute it with the crc32 instruction eight bytes at a
+ *      time, fast enough to check a strip as it comes off the disk. Others
+ *      use a table with one entry per byte value, built once.
+ *
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <string.h>
+#include "crc32c.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define POLYNOMIAL 0x82f63b78
+
+typedef uint32_t crc_kernel(uint32_t crc, const unsigned char *data,
+                            size_t size);
+
+/* the kernel chosen for this processor and the table, filled on first use */
+static crc_kernel *crc_impl;
+static uint32_t table[256];
+static pthread_once_t kernel_selected = PTHREAD_ONCE_INIT;
+
+/********** crc_table ********
+ *
+ * Updates a CRC with a run of bytes, one byte at a time, through the table
+ *
+ * Inputs:
+ *      uint32_t crc:                   the CRC so far, inverted
+ *      const unsigned char *data:      the bytes
+ *      size_t size:                    the number of bytes
+ *
+ * Return:
+ *      the CRC with the bytes added, inverted
+ ************************/
+static uint32_t crc_table(uint32_t crc, const unsigned char *data,
+                          size_t size)
+{
+        for (size_t i = 0; i < size; i++) {
+                crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return crc;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/********** crc_sse42 ********
+ *
+ * Updates a CRC with a run of bytes using the SSE4.2 crc32 instruction
+ *
+ * Inputs:
+ *      uint32_t crc:                   the CRC so far, inverted
+ *      const unsigned char *data:      the bytes
+ *      size_t size:                    the number of bytes
+ *
+ * Return:
+ *      the CRC with the bytes added, inverted, the same as crc_table's
+ ************************/
+__attribute__((target("sse4.2")))
+static uint32_t crc_sse42(uint32_t crc, const unsigned char *data,
+                          size_t size)
+{
+        uint64_t wide = crc;
+        size_t i = 0;
+
+        for (; i + 8 <= size; i += 8) {
+                uint64_t chunk;
+                memcpy(&chunk, data + i, sizeof(chunk));
+                wide = _mm_crc32_u64(wide, chunk);
+        }
+        crc = wide;
+        for (; i < size; i++) {
+                crc = _mm_crc32_u8(crc, data[i]);
+        }
+        return crc;
+}
+
+#endif
+
+/********** select_kernel ********
+ *
+ * Builds the table and picks the fastest kernel the processor supports
+ *
+ * Notes:
+ *      Run exactly once, through pthread_once
+ ************************/
+static void select_kernel(void)
+{
+        for (uint32_t byte = 0; byte < 256; byte++) {
+                uint32_t crc = byte;
+                for (int bit = 0; bit < 8; bit++) {
+                        crc = (crc >> 1) ^ (POLYNOMIAL & -(crc & 1));
+                }
+                table[byte] = crc;
+        }
+
+        crc_impl = crc_table;
+#ifdef HAVE_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2")) {
+                crc_impl = crc_sse42;
+        }
+#endif
+}
+
+/********** crc32c ********
+ *
+ * Computes the CRC-32C of a run of bytes, or continues one
+ *
+ * Inputs:
+ *      uint32_t crc:           0 to start, or the CRC of the bytes before
+ *      const void *data:       the bytes
+ *      size_t size:            the number of bytes
+ *
+ * Return:
+ *      the CRC-32C of the bytes before followed by these; the CRC-32C of
+ *      "123456789" is 0xe3069283
+ *
+ * Notes:
+ *      The kernel is chosen on the first call, safely from any thread
+ ************************/
+uint32_t crc32c(uint32_t crc, const void *data, size_t size)
+{
+        pthread_once(&kernel_selected, select_kernel);
+        return ~crc_impl(~crc, data, size);
+}
@@ -0,0 +1,24 @@
+/*******************************************************************************
+ *
+ *                                  crc32c.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for crc32c.c. It declares the CRC-32C
+ *      (Castagnoli) checksum that format 3 keeps for every strip of code
+ *      words, computed with the processor's CRC instruction where there is
+ *      one.
+ *
+ ******************************************************************************/
+
+#ifndef CRC32C_INCLUDED
+#define CRC32C_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t size);
+
+#endif
@@ -0,0 +1,190 @@
+/*******************************************************************************
+ *
+ *                                  crop.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the region of interest decompressor. Code words
+ *      are four bytes each and stored row by row of blocks, so the code
+ *      words of the blocks under any rectangle lie at offsets that follow
+ *      from the header. When the input is a regular file only those are
+ *      read, with one pread per row of blocks, and only those are decoded,
+ *      so the cost grows with the rectangle instead of the image. Any
+ *      other input is read up to the last row of blocks the rectangle
+ *      touches, but still only the blocks under it are decoded. Format 3
+ *      is read through a container reader, which uses the strip index to
+ *      read and check only the strips the rectangle touches.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "assert.h"
+#include "codeword.h"
+#include "ppmio.h"
+#include "stream.h"
+#include "container.h"
+#include "scratch.h"
+#include "stats.h"
+#include "crop.h"
+
+/********** clip ********
+ *
+ * Trims a rectangle to the part of it inside an image
+ *
+ * Inputs:
+ *      struct crop *region:    the rectangle, trimmed in place
+ *      unsigned width, height: the size of the image
+ ************************/
+static void clip(struct crop *region, unsigned width, unsigned height)
+{
+        if (region->x > width) {
+                region->x = width;
+        }
+        if (region->y > height) {
+                region->y = height;
+        }
+        if (region->width > width - region->x) {
+                region->width = width - region->x;
+        }
+        if (region->height > height - region->y) {
+                region->height = height - region->y;
+        }
+}
+
+/********** decompress40_crop ********
+ *
+ * Decompresses one rectangle of a CS40 compressed format file to a PPM
+ * image
+ *
+ * Inputs:
+ *      FILE *fp:               pointer to a CS40 compressed format file
+ *      struct crop region:     the rectangle of the decompressed image
+ *                              wanted
+ *
+ * Expects:
+ *     The file to hold a properly formatted compressed image file, in
+ *     format 2 or format 3
+ *
+ * Notes:
+ *      Writes the rectangle to stdout, pixel for pixel what decompress40
+ *      writes there; a rectangle reaching past the image is trimmed to it
+ *      A rectangle with no pixel inside the image is reported, naming the
+ *      image's size, and the program exits
+ *      One row of code words and two rows of the rectangle's blocks are
+ *      allocated from a scratch, freed at the end
+ *      A format 3 strip that is cut short or fails a check is reported,
+ *      and the program exits
+ *      The rows above the rectangle that are read through are charged to
+ *      reading along with the first row that is kept
+ ************************/
+void decompress40_crop(FILE *fp, struct crop region)
+{
+        struct stats_clock clock;
+        stats_start(&clock);
+        struct comp40_header header;
+        bool read = container_read_header(fp, &header);
+        assert(read);
+        unsigned width = header.width;
+        unsigned height = header.height;
+
+        unsigned width_in_blocks = width / 2;
+        unsigned height_in_blocks = height / 2;
+        struct crop asked = region;
+        clip(&region, 2 * width_in_blocks, 2 * height_in_blocks);
+        if (region.width == 0 || region.height == 0) {
+                fprintf(stderr, "--crop %u,%u,%u,%u: no pixel of the region "
+                        "is inside the %ux%u image\n", asked.x, asked.y,
+                        asked.width, asked.height, width, height);
+                exit(1);
+        }
+
+        /* the blocks under the rectangle, half open */
+        unsigned first_col = region.x / 2;
+        unsigned last_col = (region.x + region.width + 1) / 2;
+        unsigned first_row = region.y / 2;
+        unsigned last_row = (region.y + region.height + 1) / 2;
+        unsigned count = last_col - first_col;
+
+        /* regular files are pread in place; anything else is read through */
+        struct stat info;
+        int fd = fileno(fp);
+        off_t offset = ftello(fp);
+        bool seekable = fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+                        offset >= 0;
+
+        container_reader reader = NULL;
+        if (header.version == 3) {
+                reader = container_reader_new(fp, &header);
+                if (reader == NULL) {
+                        exit(1);
+                }
+                /* the reader skips the strips above the rectangle itself */
+                seekable = true;
+        }
+
+        scratch s = scratch_new();
+        size_t row_bytes = 6 * (size_t)count;
+        unsigned char *bytes = scratch_alloc(s, 4 * (size_t)(seekable ?
+                                                  count : width_in_blocks));
+        uint32_t *words = scratch_alloc(s, count * sizeof(uint32_t));
+        unsigned char *rows = scratch_alloc(s, 2 * row_bytes);
+        const unsigned char *src = seekable ? bytes : bytes + 4 * first_col;
+
+        ppm_write_header(stdout, region.width, region.height);
+
+        for (unsigned row = seekable ? first_row : 0; row < last_row;
+             row++) {
+                const uint32_t *row_words = words;
+                if (reader != NULL) {
+                        row_words = container_reader_row(reader, row);
+                        if (row_words == NULL) {
+                                exit(1);
+                        }
+                        row_words += first_col;
+                } else if (seekable) {
+                        off_t at = offset + 4 * ((off_t)row *
+                                                 width_in_blocks +
+                                                 first_col);
+                        ssize_t got = pread(fd, bytes, 4 * (size_t)count,
+                                            at);
+                        assert(got == 4 * (ssize_t)count);
+                } else {
+                        size_t got = fread(bytes, 4, width_in_blocks, fp);
+                        assert(got == width_in_blocks);
+                        if (row < first_row) {
+                                continue;
+                        }
+                }
+
+                if (reader == NULL) {
+                        codewords_from_bytes(src, count, words);
+                }
+                stats_lap(STATS_READ, &clock);
+                decode_block_row(row_words, count, rows, rows + row_bytes);
+                stats_lap(STATS_CODE, &clock);
+
+                for (unsigned half = 0; half < 2; half++) {
+                        unsigned y = 2 * row + half;
+                        if (y < region.y || y >= region.y + region.height) {
+                                continue;
+                        }
+                        fwrite(rows + half * row_bytes +
+                               3 * (region.x - 2 * first_col), 3,
+                               region.width, stdout);
+                }
+                stats_lap(STATS_WRITE, &clock);
+        }
+
+        stats_count(STATS_PIXELS, (uint64_t)region.width * region.height);
+        stats_count(STATS_CODEWORDS, (uint64_t)count *
+                                     (last_row - first_row));
+        scratch_free(&s);
+        if (reader != NULL) {
+                container_reader_free(&reader);
+        }
+}
@@ -0,0 +1,28 @@
+/*******************************************************************************
+ *
+ *                                  crop.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for crop.c. It declares the region of
+ *      interest decompressor, which decodes only the code words covering a
+ *      rectangle of a compressed image and writes that rectangle as a PPM.
+ *
+ ******************************************************************************/
+
+#ifndef CROP_INCLUDED
+#define CROP_INCLUDED
+
+#include <stdio.h>
+
+/* a rectangle of pixels, from its upper left corner */
+struct crop {
+        unsigned x, y;
+        unsigned width, height;
+};
+
+void decompress40_crop(FILE *fp, struct crop region);
+
+#endif
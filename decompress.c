@@ -16,6 +16,19 @@
  ******************************************************************************/
 
 #include "decompress.h"
+#include "a2inline.h"
+#include "ppmio.h"
+
+static inline void comp_vid_to_rgb_app(int col, int row, 
+                                       comp_vid comp_vid_vals,
+                                       UArray2_T rgb_array);
+static inline void words_to_comp_vid_app(int col, int row, uint32_t *word,
+                                         UArray2b_T comp_vid_arr);
+
+A2_DEFINE_MAP_BLOCK_MAJOR(map_rgb, struct comp_vid, UArray2_T, 2,
+                          comp_vid_to_rgb_app)
+A2_DEFINE_MAP_ROW_MAJOR(map_comp_vid_blocks, uint32_t, UArray2b_T,
+                        words_to_comp_vid_app)
 
 /********** comp_vid_to_rgb ********
  *
@@ -25,35 +38,28 @@
  * Inputs:
  *      UArray2b_T comp_vid_array: The image being converted from component
  *                                 video to rgb
+ *      scratch s:                 the scratch the array is allocated from
  * 
  * Return:
- *      UArray2b_T that represents the image in rgb format
+ *      UArray2_T of packed rgb8 pixels, in row major order so that each
+ *      row can be written out as is
  * 
  * Expects:
  *      A properly formatted array holding comp_vid structs 
  * 
  * Notes:
- *      Memory is allocated for the rgb array, it is freed elsewhere
  *      A mapping function is called to perform the conversion and populate
  *      the rgb array
  ************************/
-UArray2b_T comp_vid_to_rgb(UArray2b_T comp_vid_array)
+UArray2_T comp_vid_to_rgb(UArray2b_T comp_vid_array, scratch s)
 {
         A2Methods_T methods = uarray2_methods_blocked;
-        int blocksize = 2;
-        UArray2b_T rgb_array = methods->new_with_blocksize(
-                                                methods->width(comp_vid_array),
-                                                methods->height(comp_vid_array),
-                                                sizeof(struct Pnm_rgb),
-                                                blocksize);
-        meth_bundle rgb_info = NEW(rgb_info);
-        rgb_info->array = rgb_array;
-        rgb_info->methods = methods;
+        UArray2_T rgb_array = UArray2_new_scratch(s,
+                                        methods->width(comp_vid_array),
+                                        methods->height(comp_vid_array),
+                                        sizeof(struct rgb8));
 
-        methods->map_block_major(comp_vid_array, comp_vid_to_rgb_app, rgb_info);
-
-        rgb_array = rgb_info->array;
-        FREE(rgb_info);
+        map_rgb(comp_vid_array, rgb_array);
         
         return rgb_array;
 }
@@ -66,172 +72,127 @@ UArray2b_T comp_vid_to_rgb(UArray2b_T comp_vid_array)
  * Inputs:
  *      int col:                   Column index
  *      int row:                   Row index
- *      A2Methods_UArray2 array2:  the comp_vid array
- *      void *elem:                The current element in the array
- *      void * cl;                 A meth_bundle struct holding the rgb array,
- *                                 and methods
+ *      comp_vid comp_vid_vals:    The current element in the comp_vid array
+ *      UArray2_T rgb_array:       The rgb array being populated
  * 
  * Expects:
- *      All pointers to not be null, the array being mapped to be in
- *      component video format
+ *      All pointers to not be null
  * 
  * Notes:
  *      Upon completion the rgb array is fully populated
- *      A new rgb struct is allocated to store data and later freed
+ *      The samples are at most 255, so they fit the packed pixel
  ************************/
-void comp_vid_to_rgb_app(int col, int row, A2Methods_UArray2 array2, 
-                         void *elem, void *cl)
+static inline void comp_vid_to_rgb_app(int col, int row, 
+                                       comp_vid comp_vid_vals,
+                                       UArray2_T rgb_array)
 {
-        (void) array2;
-        comp_vid comp_vid_vals = elem;
-        meth_bundle rgb_info = cl;
-        assert(comp_vid_vals);
-        assert(rgb_info);
-         
-        float y = comp_vid_vals->y;
-        float pb = comp_vid_vals->pb;
-        float pr = comp_vid_vals->pr;
-
-        float r = 1.0 * y + 0.0 * pb + 1.402 * pr;
-        float g = 1.0 * y - 0.344136 * pb - 0.714136 * pr;
-        float b = 1.0 * y + 1.772 * pb + 0.0 * pr;
-        
-        unsigned red = quantize_rgb(r);
-        unsigned green = quantize_rgb(g);
-        unsigned blue = quantize_rgb(b);
-                
-        Pnm_rgb rgb_cell = NEW(rgb_cell);
-        rgb_cell->red = red;
-        rgb_cell->green = green;
-        rgb_cell->blue = blue;
-        
-        Pnm_rgb array_cell = rgb_info->methods->at(rgb_info->array, col, row);
-
-        *array_cell = *rgb_cell;
+        struct Pnm_rgb rgb_vals;
+        comp_vid_to_rgb_pixel(comp_vid_vals, &rgb_vals);
 
-        FREE(rgb_cell);
+        rgb8 array_cell = UArray2_at_inline(rgb_array, col, row);
+        *array_cell = (struct rgb8){ .red = rgb_vals.red,
+                                     .green = rgb_vals.green,
+                                     .blue = rgb_vals.blue };
 }
 
-/********** quantize_rgb ********
- * 
- * Quantizes an rgb value by multiplying it by a denominator of 255 and
- * truncating the remainder
+/********** write_rgb ********
+ *
+ * Writes an array of packed pixels to a file as a raw portable pixmap with
+ * a denominator of 255
  *
  * Inputs:
- *      float color:  the value being quantized
- * 
- * Returns:
- *      Unsigned representing the quantized color value
+ *      FILE *fp:               the file being written
+ *      UArray2_T rgb_array:    the array from comp_vid_to_rgb
  * 
  * Expects:
- *      color to be a value between 0 and 1
+ *      No pointers to be null
  * 
  * Notes:
- *      prepares rgb values to correspond with the final image denominator
- *      of 255 which is assigned later
+ *      The output is the same as Pnm_ppmwrite's; each row is written with
+ *      one call to fwrite
  ************************/
-unsigned quantize_rgb(float color)
+void write_rgb(FILE *fp, UArray2_T rgb_array)
 {
-        unsigned denominator = 255;
-        if (color > 1) {
-                color = 1;
-        }
-        if (color < 0) {
-                color = 0;
+        assert(fp && rgb_array);
+        int width = UArray2_width(rgb_array);
+        int height = UArray2_height(rgb_array);
+
+        ppm_write_header(fp, width, height);
+        for (int row = 0; row < height; row++) {
+                fwrite(UArray2_row(rgb_array, row), sizeof(struct rgb8),
+                       width, fp);
         }
-        
-        unsigned quantized_color = color * denominator;
-        return quantized_color; 
 }
 
-
-/********** word_info_to_comp_vid ********
+/********** words_to_comp_vid ********
  *
  * Allocates and populates an array of comp_Vid structs with data
- * extacted from an array of word_info structs
+ * extacted from an array of code words
  *
  * Inputs:
- *      UArray2_T word_info_arr: An array holding all the word_info data
+ *      UArray2_T word_arr: An array holding the uint32_t code words
+ *      scratch s:          the scratch the array is allocated from
  * 
  * Return:
  *      UArray2b_T that represents an image in component video format
  * 
  * Expects:
- *      word_info_arr to be an array of word_info structs
+ *      word_arr to be an array of uint32_t
  * 
  * Notes:
- *      Memory is allocated for the comp_vid array, it is freed elsewhere
  *      A mapping function is called to initialize the comp_vid array
  ************************/
-UArray2b_T word_info_to_comp_vid(UArray2_T word_info_arr)
+UArray2b_T words_to_comp_vid(UArray2_T word_arr, scratch s)
 {
-        A2Methods_T methods_b = uarray2_methods_blocked;
         A2Methods_T methods_p = uarray2_methods_plain;
         
         int blocksize = 2;
-        int new_width = methods_p->width(word_info_arr) * 2;
-        int new_height = methods_p->height(word_info_arr) * 2;
+        int new_width = methods_p->width(word_arr) * 2;
+        int new_height = methods_p->height(word_arr) * 2;
         
-        UArray2b_T comp_vid_arr = methods_b->new_with_blocksize(new_width,
-                                                                new_height,
-                                                                sizeof(struct 
-                                                                comp_vid),
-                                                                blocksize);
+        UArray2b_T comp_vid_arr = UArray2b_new_scratch(s, new_width,
+                                                       new_height,
+                                                       sizeof(struct comp_vid),
+                                                       blocksize);
 
-        methods_p->map_row_major(word_info_arr, word_info_to_comp_vid_app,
-                                 comp_vid_arr);
+        map_comp_vid_blocks(word_arr, comp_vid_arr);
 
         return comp_vid_arr;
 }
 
-/********** word_info_to_comp_vid_app ********
+/********** words_to_comp_vid_app ********
  * 
- * Extracts data from the word_info array, computes and populates
- * comp_vid data
+ * Unpacks a code word, computes and populates comp_vid data
  *
  * Inputs:
  *      int col:                   Column index
  *      int row:                   Row index
- *      A2Methods_UArray2 array2:  The word_info array
- *      void *elem:                The current element in the array
- *      void * cl;                 the comp_vid array being populated
+ *      uint32_t *word:            The current element in the array
+ *      UArray2b_T comp_vid_arr:   the comp_vid array being populated
  * 
  * Expects:
- *      Elem to not be null
+ *      No pointers to be null
  * 
  * Notes:
- *      Upon completion the word_info array is fully initialized
- *      calls a helper function to populate comp_vid struct with the
- *      extracted data
+ *      Upon completion the 2x2 block of comp_vid structs for this word is
+ *      populated
+ *      The fields are unpacked into a word_info struct that only lives
+ *      for this block
  ************************/
-void word_info_to_comp_vid_app(int col, int row, A2Methods_UArray2 array2, 
-                               void *elem, void *cl)
+static inline void words_to_comp_vid_app(int col, int row, uint32_t *word,
+                                         UArray2b_T comp_vid_arr)
 {
-        (void) array2;
-
-        UArray2b_T comp_vid_arr = cl;
-        word_info word_data_cell = elem;
-        assert(comp_vid_arr);
-        assert(word_data_cell);
+        struct word_info word_data;
+        unpack_word(*word, &word_data);
 
-        float a = word_data_cell->a / 511.0;
-        float b = word_data_cell->b / 50.0;
-        float c = word_data_cell->c / 50.0;
-        float d = word_data_cell->d / 50.0;
+        struct comp_vid block[4];
+        word_to_comp_vid(&word_data, block);
 
-        
-        float y1 = a - b - c + d;
-        float y2 = a - b + c - d;
-        float y3 = a + b - c - d;
-        float y4 = a + b + c + d;
-        float pb =  Arith40_chroma_of_index((unsigned) word_data_cell->avg_pb);
-        float pr =  Arith40_chroma_of_index((unsigned) word_data_cell->avg_pr);
-
-        populate_comp_vid_cell(y1, y2, y3, y4, pb, pr, comp_vid_arr, col, row);
-        
+        populate_comp_vid_cell(block[0].y, block[1].y, block[2].y, block[3].y,
+                               block[0].pb, block[0].pr, comp_vid_arr, 
+                               col, row);
 }
 
-
 /********** populate_comp_vid_cell ********
  * 
  * Populates a comp_vid struct with data extracted from the
@@ -252,76 +213,41 @@ void word_info_to_comp_vid_app(int col, int row, A2Methods_UArray2 array2,
  *      comp_vid_arr to be an array of comp_vid structs
  * 
  * Notes:
- *      allocates a new comp_vid struct for storage which is later freed
+ *      the four cells of the block are written in place
  ************************/
 void populate_comp_vid_cell(float y1, float y2, float y3, float y4, float pb,
                             float pr, UArray2b_T comp_vid_arr, int col, int row)
 {
-        A2Methods_T blocked_methods = uarray2_methods_blocked;
-
         int col1 = col * 2;
         int col2 = col * 2 + 1;
         int row1 = row * 2;
         int row2 = row * 2 + 1;
         
-        comp_vid cell1 = blocked_methods->at(comp_vid_arr, col1, row1);
-        comp_vid cell2 = blocked_methods->at(comp_vid_arr, col2, row1);
-        comp_vid cell3 = blocked_methods->at(comp_vid_arr, col1, row2);
-        comp_vid cell4 = blocked_methods->at(comp_vid_arr, col2, row2);
-
-        comp_vid cell1_data = new_comp_vid_cell(pb, pr, y1);
-        comp_vid cell2_data = new_comp_vid_cell(pb, pr, y2);
-        comp_vid cell3_data = new_comp_vid_cell(pb, pr, y3);
-        comp_vid cell4_data = new_comp_vid_cell(pb, pr, y4);
-
-        *cell1 = *cell1_data;
-        *cell2 = *cell2_data;
-        *cell3 = *cell3_data;
-        *cell4 = *cell4_data;
-
-        FREE(cell1_data);
-        FREE(cell2_data);
-        FREE(cell3_data);
-        FREE(cell4_data);
+        comp_vid cell1 = UArray2b_at_inline(comp_vid_arr, col1, row1);
+        comp_vid cell2 = UArray2b_at_inline(comp_vid_arr, col2, row1);
+        comp_vid cell3 = UArray2b_at_inline(comp_vid_arr, col1, row2);
+        comp_vid cell4 = UArray2b_at_inline(comp_vid_arr, col2, row2);
+
+        *cell1 = (struct comp_vid){ .y = y1, .pb = pb, .pr = pr };
+        *cell2 = (struct comp_vid){ .y = y2, .pb = pb, .pr = pr };
+        *cell3 = (struct comp_vid){ .y = y3, .pb = pb, .pr = pr };
+        *cell4 = (struct comp_vid){ .y = y4, .pb = pb, .pr = pr };
 }
 
-/********** new_comp_vid_cell ********
+/********** read_word_arr ********
  * 
- * Allocates and populates a new comp_vid struct
- *
- * Inputs:
- *      float y:   y value 
- *      float pb:  pb value 
- *      float pr:  pr value 
- * 
- * Returns:
- *      new initialized comp_vid struct
- * 
- * Expects:
- *      comp_vid_arr to be an array of comp_vid structs
- * 
- * Notes:
- *      allocates a new comp_vid struct for storage which is later freed
- ************************/
-comp_vid new_comp_vid_cell(float pb, float pr, float y)
-{
-        comp_vid new_cell = NEW(new_cell);
-        new_cell->pb = pb;
-        new_cell->pr = pr;
-        new_cell->y = y;
-
-        return new_cell;
-}
-
-/********** unpack_n_store ********
- * 
- * Given a file containing a compressed image, unpacks data into an
- *      array of word_info structs
+ * Given a file containing a compressed image, reads its code words into
+ *      an array
  *
  * Inputs:
  *      FILE *input:      file containing the compressed image
  *      unsigned width:   the width of the image
  *      unsigned height:  the height of the image   
+ *      scratch s:        the scratch the array and a row of bytes are
+ *                        allocated from
+ * 
+ * Return:
+ *      UArray2_T holding one uint32_t code word per block
  * 
  * Expects:
  *      The file to be a compressed image properly formatted to the CS40
@@ -330,91 +256,23 @@ comp_vid new_comp_vid_cell(float pb, float pr, float y)
  *      compression
  * 
  * Notes:
- *      Calls mapping function to populate each word_info struct
- ************************/
-UArray2_T unpack_n_store(FILE *input, unsigned width, unsigned height)
-{
-
-        A2Methods_T plain_methods = uarray2_methods_plain;
-        UArray2_T word_info_arr = plain_methods->new(width / 2, height / 2,
-                                                     sizeof(struct word_info));
-
-        plain_methods->map_row_major(word_info_arr, unpack_n_store_app, input);
-        
-        return word_info_arr;
-}
-
-/********** unpack_n_store_app ********
- * 
- * Packs four characters into a word, then unpacks word into a word_info struct
- * 
- * Inputs:
- *      int col:                   Column index
- *      int row:                   Row index
- *      A2Methods_UArray2 array2:  The word_info array being mapped over
- *      void *elem:                The current element in the array
- *      void * cl;                 The file stream holding the compressed image
- * 
- * Expects:
- *      The file to be a compressed image properly formatted to the CS40
- *      standards
- * 
- * Notes:
- *      Calls make_new_word_data to apply bitpack functions
+ *      Reads a row of code words at a time straight into its row of the
+ *      array
  ************************/
-void unpack_n_store_app(int col, int row,A2Methods_UArray2 array2, 
-                        void *elem, void *cl)
+UArray2_T read_word_arr(FILE *input, unsigned width, unsigned height,
+                        scratch s)
 {
-        (void) col;
-        (void) row;
-        (void) array2;
-        FILE *input = cl;
-        assert(input);
-        word_info word_data = elem;
-        assert(word_data);
-
-        uint64_t word = 0;
-        int to_pack;
-
-        /* pack 32 bit word with data from 4 chars */
-        for (int i = 3; i >= 0; i--) {
-                to_pack = getc(input);
-                word = Bitpack_newu(word, 8, 8 * i, to_pack);
+        UArray2_T word_arr = UArray2_new_scratch(s, width / 2, height / 2,
+                                                 sizeof(uint32_t));
+        unsigned width_in_blocks = width / 2;
+        unsigned char *bytes = scratch_alloc(s, 4 * (size_t)width_in_blocks);
+
+        for (unsigned row = 0; row < height / 2; row++) {
+                size_t got = fread(bytes, 4, width_in_blocks, input);
+                assert(got == width_in_blocks);
+                codewords_from_bytes(bytes, width_in_blocks,
+                                     UArray2_row(word_arr, row));
         }
-        
-        word_info new_word_data = make_new_word_data(word);
-
-        *word_data = *new_word_data;
-
-        FREE(new_word_data);
-}
-
-/********** make_new_word_data ********
- * 
- * Allocates and populates a new word_info struct
- * 
- * Inputs:
- *      uint64_t word:  code word holding data to be packed in word_info struct
- * 
- * Returns:
- *      word_info struct holding data for one code word
- * 
- * Expects:
- *      the word to be packed with data prior to being passed to this function
- * 
- * Notes:
- *      Calls bitpack functions to unpack data into word_info struct
- ************************/
-word_info make_new_word_data(uint64_t word)
-{
-        word_info new_word_data = NEW(new_word_data);
-
-        new_word_data->a = Bitpack_getu(word, 9, 23);
-        new_word_data->b = Bitpack_gets(word, 5, 18);
-        new_word_data->c = Bitpack_gets(word, 5, 13);
-        new_word_data->d = Bitpack_gets(word, 5, 8);
-        new_word_data->avg_pb = Bitpack_getu(word, 4, 4);
-        new_word_data->avg_pr = Bitpack_getu(word, 4, 0);
 
-        return new_word_data;
+        return word_arr;
 }
@@ -33,21 +33,20 @@
 #include <arith40.h>
 #include "struct_def.h"
 #include "bitpack.h"
+#include "uarray2_ext.h"
+#include "uarray2b_ext.h"
+#include "scratch.h"
+#include "codeword.h"
+#include "quant.h"
+#include "blockrow.h"
 
 
-UArray2b_T comp_vid_to_rgb(UArray2b_T comp_vid_array);
-void comp_vid_to_rgb_app(int col, int row, A2Methods_UArray2 array2, 
-                         void *elem, void *cl);
-unsigned quantize_rgb(float color);
-UArray2b_T word_info_to_comp_vid(UArray2_T word_info_arr);
-void word_info_to_comp_vid_app(int col, int row, A2Methods_UArray2 array2, 
-                               void *elem, void *cl);
+UArray2_T comp_vid_to_rgb(UArray2b_T comp_vid_array, scratch s);
+void write_rgb(FILE *fp, UArray2_T rgb_array);
+UArray2b_T words_to_comp_vid(UArray2_T word_arr, scratch s);
 void populate_comp_vid_cell(float y1, float y2, float y3, float y4, float pb,
                             float pr, UArray2b_T comp_vid_arr, int col, 
                             int row);
-comp_vid new_comp_vid_cell(float pb, float pr, float y);
-UArray2_T unpack_n_store(FILE *input, unsigned width, unsigned height);
-void unpack_n_store_app(int col, int row,A2Methods_UArray2 array2, 
-                        void *elem, void *cl);
-word_info make_new_word_data(uint64_t word);
+UArray2_T read_word_arr(FILE *input, unsigned width, unsigned height,
+                        scratch s);
 #endif
\ No newline at end of file
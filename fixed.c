@@ -0,0 +1,307 @@
+/*******************************************************************************
+ *
+ *                                  fixed.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains integer fixed point versions of the color
+ *      conversion, 2x2 transform and quantization, and of their inverses.
+ *      Every value that the floating point codec keeps as a float in
+ *      [0, 1] or [-0.5, 0.5] is kept here as an int32_t scaled by 2^14
+ *      (Q14), so one is ONE and the sum of a block's four pixels is the
+ *      block's average scaled by 2^16. The coefficients of the color
+ *      transforms are rounded to Q14 so that each row of the forward
+ *      transform still sums to exactly one or zero.
+ *
+ *      Products of a Q14 sample and a Q14 coefficient are below 2^29, so
+ *      all of the arithmetic fits in 32 bits except the normalization of
+ *      a sample by the image's denominator, which takes one 32 by 32 bit
+ *      multiply into 64 bits in place of a division.
+ *
+ *      Truncations and clamps are done where the floating point codec
+ *      does them, so the two differ only by the rounding of the Q14
+ *      values; see fixed_encode_block_row for how the error was checked.
+ *
+ ******************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include <arith40.h>
+#include "assert.h"
+#include "codeword.h"
+#include "quant.h"
+#include "fixed.h"
+
+#define FRACTION_BITS 14
+#define ONE (1 << FRACTION_BITS)
+#define HALF (1 << (FRACTION_BITS - 1))
+
+/* rgb_to_comp_vid_pixel's coefficients in Q14 */
+#define Y_R   4899
+#define Y_G   9617
+#define Y_B   1868
+#define PB_R -2765
+#define PB_G -5427
+#define PB_B  8192
+#define PR_R  8192
+#define PR_G -6860
+#define PR_B -1332
+
+/* comp_vid_to_rgb_pixel's coefficients in Q14 */
+#define R_PR 22970
+#define G_PB  5638
+#define G_PR 11700
+#define B_PB 29032
+
+/* 0.3, the bound on b, c and d, for a sum of four Q14 values */
+#define COEFFICIENT_LIMIT 19661
+
+static bool fixed_point = false;
+
+struct fixed_tables {
+        int32_t thresholds[CHROMA_THRESHOLDS];  /* chroma_thresholds for
+                                                   a sum of four Pb or Pr */
+        int32_t a[512];         /* code a of the 9 bit field: a / 511 */
+        int32_t bcd[32];        /* raw bits of a 5 bit b, c or d field */
+        int32_t chroma[16];     /* Arith40_chroma_of_index of each index */
+};
+
+static struct fixed_tables tables;
+static pthread_once_t tables_built = PTHREAD_ONCE_INIT;
+
+/********** fixed_point_select ********
+ *
+ * Chooses between the fixed point and floating point block row kernels
+ *
+ * Inputs:
+ *      bool on: true for the fixed point kernels
+ *
+ * Notes:
+ *      Must be called before any image is compressed or decompressed
+ ************************/
+void fixed_point_select(bool on)
+{
+        fixed_point = on;
+}
+
+/********** fixed_point_selected ********
+ *
+ * Return:
+ *      true if the fixed point kernels have been selected
+ ************************/
+bool fixed_point_selected(void)
+{
+        return fixed_point;
+}
+
+/********** build_fixed_tables ********
+ *
+ * Fills in the Q14 quantization and dequantization tables from the
+ * floating point ones
+ *
+ * Notes:
+ *      Run exactly once, through pthread_once
+ *      A sum of four Q14 values is the average scaled by 2^16, which a
+ *      float threshold t is at most exactly when it is at least
+ *      ceil(t * 2^16); an unreachable threshold becomes INT32_MAX
+ ************************/
+static void build_fixed_tables(void)
+{
+        const float *t = chroma_thresholds();
+        for (int k = 0; k < CHROMA_THRESHOLDS; k++) {
+                tables.thresholds[k] = isinf(t[k]) ? INT32_MAX
+                                       : (int32_t)ceil(t[k] * 65536.0);
+        }
+        for (int a = 0; a < 512; a++) {
+                tables.a[a] = lrint(a * (double)ONE / 511);
+        }
+        for (int bits = 0; bits < 32; bits++) {
+                int value = bits < 16 ? bits : bits - 32;
+                tables.bcd[bits] = lrint(value * (double)ONE / 50);
+        }
+        for (unsigned index = 0; index < 16; index++) {
+                tables.chroma[index] =
+                        lrint(Arith40_chroma_of_index(index) * (double)ONE);
+        }
+}
+
+/********** quantize_fixed_coefficient ********
+ *
+ * Quantizes a sum of four signed Q14 Y values, b, c or d, to a 5 bit code
+ *
+ * Inputs:
+ *      int32_t sum: the sum of the block
+ *
+ * Return:
+ *      the code, the clamped average times 50 truncated toward zero
+ ************************/
+static inline int quantize_fixed_coefficient(int32_t sum)
+{
+        sum = sum > COEFFICIENT_LIMIT ? COEFFICIENT_LIMIT : sum;
+        sum = sum < -COEFFICIENT_LIMIT ? -COEFFICIENT_LIMIT : sum;
+        return sum * 50 / (4 * ONE);
+}
+
+/********** quantize_fixed_chroma ********
+ *
+ * Quantizes a sum of four Q14 Pb or Pr values to a 4 bit chroma index
+ *
+ * Inputs:
+ *      int32_t sum: the sum of the block
+ *
+ * Return:
+ *      the index, the number of thresholds the sum is at least
+ ************************/
+static inline unsigned quantize_fixed_chroma(int32_t sum)
+{
+        unsigned index = 0;
+        for (int k = 0; k < CHROMA_THRESHOLDS; k++) {
+                index += sum >= tables.thresholds[k];
+        }
+        return index;
+}
+
+/********** fixed_encode_block_row ********
+ *
+ * Computes the code words for one row of 2x2 blocks in fixed point
+ *
+ * Inputs:
+ *      const struct rgb16 *top:        the upper row of pixels
+ *      const struct rgb16 *bottom:     the lower row of pixels
+ *      unsigned width_in_blocks:       the number of blocks in the row
+ *      unsigned denominator:           the denominator of the image
+ *      uint32_t *words:                receives one code word per block
+ *
+ * Expects:
+ *      top and bottom to hold at least 2 * width_in_blocks pixels
+ *      words to have room for width_in_blocks code words
+ *      denominator to be at least 1 and at most 65535
+ *
+ * Notes:
+ *      A sample v becomes v * 2^14 / denominator, rounded, by multiplying
+ *      with 2^30 / denominator and shifting right by 16
+ *      Checked against the floating point codec by compressing and
+ *      decompressing photographs and flat and graded test images both
+ *      ways and comparing each with the original using ppmdiff; the
+ *      errors agreed to the four places ppmdiff prints on every image,
+ *      with fewer than one code word in a hundred changed
+ ************************/
+void fixed_encode_block_row(const struct rgb16 *top,
+                            const struct rgb16 *bottom,
+                            unsigned width_in_blocks, unsigned denominator,
+                            uint32_t *words)
+{
+        assert(top && bottom && words);
+        assert(denominator > 0);
+        pthread_once(&tables_built, build_fixed_tables);
+        uint32_t scale = ((UINT32_C(1) << 30) + denominator / 2) / denominator;
+
+        for (unsigned i = 0; i < width_in_blocks; i++) {
+                /* top left, bottom left, top right, bottom right */
+                const struct rgb16 *pixels[4] = {
+                        &top[2 * i], &bottom[2 * i],
+                        &top[2 * i + 1], &bottom[2 * i + 1]
+                };
+                int32_t y[4], pb = 0, pr = 0;
+
+                for (int k = 0; k < 4; k++) {
+                        int32_t r = ((uint64_t)pixels[k]->red * scale +
+                                     (1 << 15)) >> 16;
+                        int32_t g = ((uint64_t)pixels[k]->green * scale +
+                                     (1 << 15)) >> 16;
+                        int32_t b = ((uint64_t)pixels[k]->blue * scale +
+                                     (1 << 15)) >> 16;
+                        y[k] = (Y_R * r + Y_G * g + Y_B * b + HALF) >>
+                               FRACTION_BITS;
+                        pb += (PB_R * r + PB_G * g + PB_B * b + HALF) >>
+                              FRACTION_BITS;
+                        pr += (PR_R * r + PR_G * g + PR_B * b + HALF) >>
+                              FRACTION_BITS;
+                }
+
+                int32_t a = y[0] + y[1] + y[2] + y[3];
+                int32_t b = -y[0] + y[1] - y[2] + y[3];
+                int32_t c = -y[0] - y[1] + y[2] + y[3];
+                int32_t d = y[0] - y[1] - y[2] + y[3];
+
+                words[i] = CODEWORD_PUT(A, (a * 511) >> (FRACTION_BITS + 2)) |
+                           CODEWORD_PUT(B, quantize_fixed_coefficient(b)) |
+                           CODEWORD_PUT(C, quantize_fixed_coefficient(c)) |
+                           CODEWORD_PUT(D, quantize_fixed_coefficient(d)) |
+                           CODEWORD_PUT(PB, quantize_fixed_chroma(pb)) |
+                           CODEWORD_PUT(PR, quantize_fixed_chroma(pr));
+        }
+}
+
+/********** fixed_sample ********
+ *
+ * Converts a Q14 red, green or blue value to a sample with a denominator
+ * of 255
+ *
+ * Inputs:
+ *      int32_t x: the value
+ *
+ * Return:
+ *      x clamped to [0, 1], times 255, truncated
+ ************************/
+static inline unsigned char fixed_sample(int32_t x)
+{
+        x = x > ONE ? ONE : x;
+        x = x < 0 ? 0 : x;
+        return (x * 255) >> FRACTION_BITS;
+}
+
+/********** fixed_decode_block_row ********
+ *
+ * Computes the two rows of pixels described by one row of code words in
+ * fixed point
+ *
+ * Inputs:
+ *      const uint32_t *words:          the code words, one per block
+ *      unsigned width_in_blocks:       the number of blocks in the row
+ *      unsigned char *top:             receives the upper row of pixels
+ *      unsigned char *bottom:          receives the lower row of pixels
+ *
+ * Expects:
+ *      top and bottom to have room for 2 * width_in_blocks pixels, 3 bytes
+ *      per pixel
+ *
+ * Notes:
+ *      Pixels are written as raw pixmap samples with a denominator of 255
+ ************************/
+void fixed_decode_block_row(const uint32_t *words, unsigned width_in_blocks,
+                            unsigned char *top, unsigned char *bottom)
+{
+        assert(words && top && bottom);
+        pthread_once(&tables_built, build_fixed_tables);
+
+        for (unsigned i = 0; i < width_in_blocks; i++) {
+                uint32_t word = words[i];
+                int32_t a = tables.a[CODEWORD_GETU(A, word)];
+                int32_t b = tables.bcd[CODEWORD_GETU(B, word)];
+                int32_t c = tables.bcd[CODEWORD_GETU(C, word)];
+                int32_t d = tables.bcd[CODEWORD_GETU(D, word)];
+                int32_t pb = tables.chroma[CODEWORD_GETU(PB, word)];
+                int32_t pr = tables.chroma[CODEWORD_GETU(PR, word)];
+
+                /* top left, top right, bottom left, bottom right */
+                int32_t y[4] = { a - b - c + d, a - b + c - d,
+                                 a + b - c - d, a + b + c + d };
+
+                /* the chroma terms are shared by the block's pixels */
+                int32_t r_off = (R_PR * pr + HALF) >> FRACTION_BITS;
+                int32_t g_off = (-G_PB * pb - G_PR * pr + HALF) >>
+                                FRACTION_BITS;
+                int32_t b_off = (B_PB * pb + HALF) >> FRACTION_BITS;
+
+                for (int k = 0; k < 4; k++) {
+                        unsigned char *px = (k < 2 ? top : bottom) +
+                                            6 * i + 3 * (k & 1);
+                        px[0] = fixed_sample(y[k] + r_off);
+                        px[1] = fixed_sample(y[k] + g_off);
+                        px[2] = fixed_sample(y[k] + b_off);
+                }
+        }
+}
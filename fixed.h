@@ -0,0 +1,39 @@
+/*******************************************************************************
+ *
+ *                                  fixed.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for fixed.c, the integer fixed point
+ *      versions of the block row kernels. They write and read the same
+ *      code word format as the floating point kernels, so a file
+ *      compressed by either can be decompressed by either, but the
+ *      pixels and code words they give may differ by a rounding step.
+ *
+ *      fixed_point_select chooses which kernels encode_block_row and
+ *      decode_block_row in stream.c run; the floating point kernels are
+ *      the default.
+ *
+ ******************************************************************************/
+
+#ifndef FIXED_INCLUDED
+#define FIXED_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pnm.h>
+#include "struct_def.h"
+
+void fixed_point_select(bool on);
+bool fixed_point_selected(void);
+
+void fixed_encode_block_row(const struct rgb16 *top,
+                            const struct rgb16 *bottom,
+                            unsigned width_in_blocks, unsigned denominator,
+                            uint32_t *words);
+void fixed_decode_block_row(const uint32_t *words, unsigned width_in_blocks,
+                            unsigned char *top, unsigned char *bottom);
+
+#endif
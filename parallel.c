@@ -0,0 +1,367 @@
+/*******************************************************************************
+ *
+ *                                  parallel.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the multithreaded compressor. Every code word
+ *      depends only on the four pixels of its own block, so the image is
+ *      cut into horizontal bands of block rows and each band is converted,
+ *      transformed, quantized and packed by encode_block_row on a worker
+ *      thread. Bands are written in order, so the output is byte for byte
+ *      what the serial compressor writes.
+ *
+ *      Bands are handled a batch at a time, one band per worker, and two
+ *      batches are kept in flight: while the workers encode one batch the
+ *      main thread reads the next from the input, then writes the finished
+ *      batch out. Memory stays bounded by the batch size rather than
+ *      growing with the image.
+ *
+ *      Decompression runs the other way around. Every code word is exactly
+ *      four bytes, so the offset of any row of blocks follows from the
+ *      header. The rows are split into ranges and each range is decoded on
+ *      its own thread straight into its part of the output raster, which
+ *      is then written as one raw pixmap. When the input is a regular file
+ *      each thread preads its own code words; otherwise the code words are
+ *      read into memory first.
+ *
+ ******************************************************************************/
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include "compress.h"
+#include "ppmio.h"
+#include "stream.h"
+#include "pool.h"
+#include "scratch.h"
+#include "container.h"
+#include "stats.h"
+#include "parallel.h"
+
+/* approximate bytes of pixels held by one band */
+#define BAND_BYTES (1 << 20)
+
+/* ranges of block rows handed out per decompression thread, for balance */
+#define RANGES_PER_THREAD 4
+
+struct band {
+        struct rgb16 *pixels;           /* 2 * block_rows rows of pixels */
+        uint32_t *words;                /* block_rows rows of code words */
+        unsigned block_rows;            /* rows of blocks currently held */
+        unsigned stride;                /* pixels per row, as read */
+        unsigned width_in_blocks;
+        unsigned denominator;
+};
+
+/********** encode_band ********
+ *
+ * Computes the code words for every row of blocks in a band
+ *
+ * Inputs:
+ *      void *cl: the band being encoded
+ *
+ * Expects:
+ *      cl to not be null
+ *
+ * Notes:
+ *      Run on a worker thread; touches nothing but its own band
+ ************************/
+static void encode_band(void *cl)
+{
+        struct band *band = cl;
+        assert(band);
+        struct stats_clock clock;
+        stats_start(&clock);
+
+        for (unsigned row = 0; row < band->block_rows; row++) {
+                const struct rgb16 *top = band->pixels +
+                                          2 * row * band->stride;
+                encode_block_row(top, top + band->stride,
+                                 band->width_in_blocks, band->denominator,
+                                 band->words + row * band->width_in_blocks);
+        }
+        stats_job_lap(STATS_CODE, &clock);
+}
+
+/********** read_batch ********
+ *
+ * Reads the pixels for up to one batch of bands from the input
+ *
+ * Inputs:
+ *      ppm_reader reader:      the reader for the image
+ *      struct band *bands:     the batch being filled
+ *      unsigned nbands:        the number of bands in the batch
+ *      unsigned band_rows:     the most rows of blocks a band may hold
+ *      unsigned *next_row:     the next row of blocks to read, updated
+ *      unsigned height_in_blocks: the number of rows of blocks in the
+ *                                 trimmed image
+ *
+ * Return:
+ *      the number of bands filled, 0 once the image is exhausted
+ ************************/
+static unsigned read_batch(ppm_reader reader, struct band *bands,
+                           unsigned nbands, unsigned band_rows,
+                           unsigned *next_row, unsigned height_in_blocks)
+{
+        unsigned filled = 0;
+
+        while (filled < nbands && *next_row < height_in_blocks) {
+                struct band *band = &bands[filled++];
+                unsigned left = height_in_blocks - *next_row;
+                band->block_rows = left < band_rows ? left : band_rows;
+                for (unsigned row = 0; row < 2 * band->block_rows; row++) {
+                        ppm_read_row(reader,
+                                     band->pixels + row * band->stride);
+                }
+                *next_row += band->block_rows;
+        }
+
+        return filled;
+}
+
+/********** compress40_parallel ********
+ *
+ * Compresses a PPM image file to CS40 compressed format, spreading the
+ * work across a pool of threads
+ *
+ * Inputs:
+ *      FILE *fp:               pointer to a file holding a PPM image
+ *      unsigned nthreads:      the number of worker threads to use
+ *
+ * Expects:
+ *     The file to hold a properly formatted PPM image, nthreads to be
+ *     positive
+ *
+ * Notes:
+ *      Writes compressed image to stdout, identical to compress40's output
+ *      Two batches of bands are allocated from a scratch, freed at the end
+ ************************/
+void compress40_parallel(FILE *fp, unsigned nthreads)
+{
+        assert(nthreads > 0);
+        struct stats_clock clock;
+        stats_start(&clock);
+        ppm_reader reader = ppm_reader_new(fp);
+        unsigned width = reader->width - reader->width % 2;
+        unsigned height = reader->height - reader->height % 2;
+        unsigned width_in_blocks = width / 2;
+        unsigned height_in_blocks = height / 2;
+
+        unsigned band_rows = BAND_BYTES /
+                ((2 * reader->width + 1) * sizeof(struct rgb16));
+        if (band_rows == 0) {
+                band_rows = 1;
+        }
+
+        scratch s = scratch_new();
+        struct band *batches[2];
+        for (int b = 0; b < 2; b++) {
+                batches[b] = scratch_calloc(s, nthreads, sizeof(struct band));
+                for (unsigned i = 0; i < nthreads; i++) {
+                        struct band *band = &batches[b][i];
+                        band->stride = reader->width;
+                        band->width_in_blocks = width_in_blocks;
+                        band->denominator = reader->denominator;
+                        band->pixels = scratch_alloc(s, 2 * band_rows *
+                                                     (size_t)reader->width *
+                                                     sizeof(struct rgb16));
+                        band->words = scratch_alloc(s, band_rows *
+                                                    (size_t)width_in_blocks *
+                                                    sizeof(uint32_t));
+                }
+        }
+
+        printf("COMP40 Compressed image format 2\n%u %u\n", width, height);
+
+        pool workers = pool_new(nthreads);
+        unsigned next_row = 0;
+        unsigned filled[2];
+        int current = 0;
+
+        filled[current] = read_batch(reader, batches[current], nthreads,
+                                     band_rows, &next_row, height_in_blocks);
+        stats_lap(STATS_READ, &clock);
+        for (unsigned i = 0; i < filled[current]; i++) {
+                pool_submit(workers, encode_band, &batches[current][i]);
+        }
+
+        while (filled[current] > 0) {
+                int next = 1 - current;
+                filled[next] = read_batch(reader, batches[next], nthreads,
+                                          band_rows, &next_row,
+                                          height_in_blocks);
+                stats_lap(STATS_READ, &clock);
+                pool_wait(workers);
+                stats_wait_lap(STATS_CODE, &clock);
+
+                for (unsigned i = 0; i < filled[current]; i++) {
+                        struct band *band = &batches[current][i];
+                        write_words(stdout, band->words,
+                                    band->block_rows * width_in_blocks);
+                }
+                stats_lap(STATS_WRITE, &clock);
+                for (unsigned i = 0; i < filled[next]; i++) {
+                        pool_submit(workers, encode_band, &batches[next][i]);
+                }
+                current = next;
+        }
+
+        pool_free(&workers);
+        stats_count(STATS_PIXELS, (uint64_t)width * height);
+        stats_count(STATS_CODEWORDS, (uint64_t)width * height / 4);
+        scratch_free(&s);
+        ppm_reader_free(&reader);
+}
+
+struct range {
+        unsigned first_row, last_row;   /* rows of blocks, half open */
+        unsigned width_in_blocks;
+        int fd;                         /* file to pread from, or -1 */
+        off_t offset;                   /* file offset of block row 0 */
+        const unsigned char *bytes;     /* code words in memory, or NULL */
+        unsigned char *raster;          /* the whole output raster */
+        unsigned char *row_bytes;       /* room for one row of code words, */
+        uint32_t *words;                /* as read and as unpacked         */
+};
+
+/********** decode_range ********
+ *
+ * Decodes a range of rows of code words into the output raster
+ *
+ * Inputs:
+ *      void *cl: the range being decoded
+ *
+ * Expects:
+ *      cl to not be null, the input to hold every code word of the range
+ *
+ * Notes:
+ *      Run on a worker thread; reads only its own code words and writes
+ *      only its own rows of the raster
+ ************************/
+static void decode_range(void *cl)
+{
+        struct range *range = cl;
+        assert(range);
+        unsigned width_in_blocks = range->width_in_blocks;
+        size_t row_bytes = 4 * (size_t)width_in_blocks;
+        size_t raster_row = 6 * (size_t)width_in_blocks;
+        unsigned char *bytes = range->row_bytes;
+        uint32_t *words = range->words;
+        struct stats_clock clock;
+        stats_start(&clock);
+
+        for (unsigned row = range->first_row; row < range->last_row; row++) {
+                const unsigned char *src;
+                if (range->bytes != NULL) {
+                        src = range->bytes + row * row_bytes;
+                } else {
+                        ssize_t got = pread(range->fd, bytes, row_bytes,
+                                            range->offset + row * row_bytes);
+                        assert(got == (ssize_t)row_bytes);
+                        src = bytes;
+                }
+
+                codewords_from_bytes(src, width_in_blocks, words);
+
+                unsigned char *top = range->raster + 2 * row * raster_row;
+                decode_block_row(words, width_in_blocks, top,
+                                 top + raster_row);
+        }
+        stats_job_lap(STATS_CODE, &clock);
+}
+
+/********** decompress40_parallel ********
+ *
+ * Decompresses a CS40 compressed format file to a PPM image, spreading
+ * the work across a pool of threads
+ *
+ * Inputs:
+ *      FILE *fp:               pointer to a CS40 compressed format file
+ *      unsigned nthreads:      the number of worker threads to use
+ *
+ * Expects:
+ *     The file to hold a properly formatted compressed image file, in
+ *     format 2 or format 3, nthreads to be positive
+ *
+ * Notes:
+ *      Writes decompressed image to stdout, identical to decompress40's
+ *      output
+ *      The output raster and each range's buffers are allocated from a
+ *      scratch on this thread, before the range is handed to a worker,
+ *      and freed at the end
+ ************************/
+void decompress40_parallel(FILE *fp, unsigned nthreads)
+{
+        assert(nthreads > 0);
+        struct comp40_header header;
+        bool read = container_read_header(fp, &header);
+        assert(read);
+        if (header.version == 3) {
+                if (!container_decompress(fp, &header, nthreads, stdout)) {
+                        exit(1);
+                }
+                return;
+        }
+        unsigned width = header.width;
+        unsigned height = header.height;
+
+        unsigned width_in_blocks = width / 2;
+        unsigned height_in_blocks = height / 2;
+        size_t word_bytes = 4 * (size_t)width_in_blocks * height_in_blocks;
+        size_t raster_bytes = 12 * (size_t)width_in_blocks * height_in_blocks;
+        struct stats_clock clock;
+        stats_start(&clock);
+        scratch s = scratch_new();
+        unsigned char *raster = scratch_alloc(s, raster_bytes);
+
+        /* regular files are read in place; anything else is slurped */
+        struct stat info;
+        int fd = fileno(fp);
+        off_t offset = ftello(fp);
+        unsigned char *bytes = NULL;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || offset < 0) {
+                bytes = scratch_alloc(s, word_bytes);
+                size_t got = fread(bytes, 1, word_bytes, fp);
+                assert(got == word_bytes);
+                fd = -1;
+        }
+        stats_lap(STATS_READ, &clock);
+
+        unsigned nranges = nthreads * RANGES_PER_THREAD;
+        if (nranges > height_in_blocks) {
+                nranges = height_in_blocks;
+        }
+        struct range *ranges = scratch_calloc(s, nranges,
+                                              sizeof(struct range));
+        pool workers = pool_new(nthreads);
+
+        for (unsigned i = 0; i < nranges; i++) {
+                struct range *range = &ranges[i];
+                range->first_row = (uint64_t)height_in_blocks * i / nranges;
+                range->last_row = (uint64_t)height_in_blocks * (i + 1) / 
+                                  nranges;
+                range->width_in_blocks = width_in_blocks;
+                range->fd = fd;
+                range->offset = offset;
+                range->bytes = bytes;
+                range->raster = raster;
+                range->row_bytes = scratch_alloc(s, 4 *
+                                                    (size_t)width_in_blocks);
+                range->words = scratch_alloc(s, width_in_blocks *
+                                                sizeof(uint32_t));
+                pool_submit(workers, decode_range, range);
+        }
+        pool_wait(workers);
+        pool_free(&workers);
+        stats_wait_lap(STATS_CODE, &clock);
+
+        ppm_write_header(stdout, 2 * width_in_blocks, 2 * height_in_blocks);
+        fwrite(raster, 1, raster_bytes, stdout);
+        stats_lap(STATS_WRITE, &clock);
+        stats_count(STATS_PIXELS, raster_bytes / 3);
+        stats_count(STATS_CODEWORDS, word_bytes / 4);
+
+        scratch_free(&s);
+}
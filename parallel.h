@@ -0,0 +1,23 @@
+/*******************************************************************************
+ *
+ *                                  parallel.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for parallel.c. It declares the
+ *      multithreaded versions of compress40 and decompress40, which give
+ *      exactly the same output as the serial versions.
+ *
+ ******************************************************************************/
+
+#ifndef PARALLEL_INCLUDED
+#define PARALLEL_INCLUDED
+
+#include <stdio.h>
+
+void compress40_parallel(FILE *fp, unsigned nthreads);
+void decompress40_parallel(FILE *fp, unsigned nthreads);
+
+#endif
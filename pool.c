@@ -0,0 +1,232 @@
+/*******************************************************************************
+ *
+ *                                  pool.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains a fixed size pool of worker threads. Jobs are a
+ *      function and a closure, in the same spirit as the apply functions
+ *      handed to the A2Methods mapping functions. They are kept in a first
+ *      in, first out queue guarded by one mutex; pool_wait blocks until
+ *      every job submitted so far has finished, which is the only ordering
+ *      the callers need since they write results out in order themselves.
+ *
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <mem.h>
+#include "assert.h"
+#include "pool.h"
+#include "stats.h"
+
+struct job {
+        pool_job *apply;
+        void *cl;
+        struct job *next;
+};
+
+struct pool {
+        pthread_t *threads;
+        unsigned nthreads;
+        pthread_mutex_t lock;
+        pthread_cond_t work_ready;      /* signalled when a job is queued */
+        pthread_cond_t all_done;        /* signalled when pending hits 0 */
+        struct job *head, *tail;
+        unsigned pending;               /* queued plus running jobs */
+        bool stopping;
+};
+
+/********** worker ********
+ *
+ * The body of every worker thread: takes jobs off the queue and runs
+ * them until the pool is freed
+ *
+ * Inputs:
+ *      void *cl: the pool the thread belongs to
+ *
+ * Return:
+ *      NULL
+ ************************/
+static void *worker(void *cl)
+{
+        pool workers = cl;
+
+        pthread_mutex_lock(&workers->lock);
+        for (;;) {
+                while (workers->head == NULL && !workers->stopping) {
+                        pthread_cond_wait(&workers->work_ready,
+                                          &workers->lock);
+                }
+                if (workers->head == NULL) {
+                        break;
+                }
+
+                struct job *job = workers->head;
+                workers->head = job->next;
+                if (workers->head == NULL) {
+                        workers->tail = NULL;
+                }
+                pthread_mutex_unlock(&workers->lock);
+
+                job->apply(job->cl);
+                FREE(job);
+
+                pthread_mutex_lock(&workers->lock);
+                if (--workers->pending == 0) {
+                        pthread_cond_broadcast(&workers->all_done);
+                }
+        }
+        pthread_mutex_unlock(&workers->lock);
+
+        return NULL;
+}
+
+/********** pool_new ********
+ *
+ * Starts a pool of worker threads
+ *
+ * Inputs:
+ *      unsigned nthreads: the number of worker threads
+ *
+ * Return:
+ *      the new pool
+ *
+ * Expects:
+ *      nthreads to be positive
+ *
+ * Notes:
+ *      Memory is allocated for the pool, it is freed by pool_free
+ ************************/
+pool pool_new(unsigned nthreads)
+{
+        assert(nthreads > 0);
+        pool workers;
+        NEW(workers);
+        workers->nthreads = nthreads;
+        workers->threads = ALLOC(nthreads * sizeof(pthread_t));
+        stats_allocation(sizeof(*workers));
+        stats_allocation(nthreads * sizeof(pthread_t));
+        workers->head = workers->tail = NULL;
+        workers->pending = 0;
+        workers->stopping = false;
+        pthread_mutex_init(&workers->lock, NULL);
+        pthread_cond_init(&workers->work_ready, NULL);
+        pthread_cond_init(&workers->all_done, NULL);
+
+        for (unsigned i = 0; i < nthreads; i++) {
+                int failed = pthread_create(&workers->threads[i], NULL,
+                                            worker, workers);
+                assert(!failed);
+        }
+
+        return workers;
+}
+
+/********** pool_free ********
+ *
+ * Finishes any outstanding jobs, stops the worker threads and frees a pool
+ *
+ * Inputs:
+ *      pool *workers: pointer to the pool being freed
+ *
+ * Expects:
+ *      workers and *workers to not be null
+ ************************/
+void pool_free(pool *workers)
+{
+        assert(workers && *workers);
+        pool p = *workers;
+
+        pthread_mutex_lock(&p->lock);
+        p->stopping = true;
+        pthread_cond_broadcast(&p->work_ready);
+        pthread_mutex_unlock(&p->lock);
+
+        for (unsigned i = 0; i < p->nthreads; i++) {
+                pthread_join(p->threads[i], NULL);
+        }
+
+        pthread_cond_destroy(&p->all_done);
+        pthread_cond_destroy(&p->work_ready);
+        pthread_mutex_destroy(&p->lock);
+        FREE(p->threads);
+        FREE(*workers);
+}
+
+/********** pool_submit ********
+ *
+ * Queues a job to be run by one of the worker threads
+ *
+ * Inputs:
+ *      pool workers:   the pool
+ *      pool_job job:   the function to run
+ *      void *cl:       the closure passed to job
+ *
+ * Expects:
+ *      workers and job to not be null
+ *
+ * Notes:
+ *      Jobs start in the order they are submitted, but may finish in any
+ *      order
+ ************************/
+void pool_submit(pool workers, pool_job job, void *cl)
+{
+        assert(workers && job);
+        struct job *entry;
+        NEW(entry);
+        stats_allocation(sizeof(*entry));
+        entry->apply = job;
+        entry->cl = cl;
+        entry->next = NULL;
+
+        pthread_mutex_lock(&workers->lock);
+        if (workers->tail == NULL) {
+                workers->head = entry;
+        } else {
+                workers->tail->next = entry;
+        }
+        workers->tail = entry;
+        workers->pending++;
+        pthread_cond_signal(&workers->work_ready);
+        pthread_mutex_unlock(&workers->lock);
+}
+
+/********** pool_wait ********
+ *
+ * Blocks until every job submitted to the pool has finished
+ *
+ * Inputs:
+ *      pool workers: the pool
+ *
+ * Expects:
+ *      workers to not be null
+ ************************/
+void pool_wait(pool workers)
+{
+        assert(workers);
+
+        pthread_mutex_lock(&workers->lock);
+        while (workers->pending > 0) {
+                pthread_cond_wait(&workers->all_done, &workers->lock);
+        }
+        pthread_mutex_unlock(&workers->lock);
+}
+
+/********** pool_size ********
+ *
+ * Returns the number of worker threads in a pool
+ *
+ * Inputs:
+ *      pool workers: the pool
+ *
+ * Expects:
+ *      workers to not be null
+ ************************/
+unsigned pool_size(pool workers)
+{
+        assert(workers);
+        return workers->nthreads;
+}
@@ -0,0 +1,29 @@
+/*******************************************************************************
+ *
+ *                                  pool.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for pool.c. It declares a fixed size pool of
+ *      worker threads that run jobs submitted to a shared queue, which the
+ *      parallel compressor and decompressor use to spread bands of an
+ *      image across cores.
+ *
+ ******************************************************************************/
+
+#ifndef POOL_INCLUDED
+#define POOL_INCLUDED
+
+typedef struct pool *pool;
+
+typedef void pool_job(void *cl);
+
+pool pool_new(unsigned nthreads);
+void pool_free(pool *workers);
+void pool_submit(pool workers, pool_job job, void *cl);
+void pool_wait(pool workers);
+unsigned pool_size(pool workers);
+
+#endif
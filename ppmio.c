@@ -0,0 +1,401 @@
+/*******************************************************************************
+ *
+ *                                  ppmio.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the functions for reading a portable pixmap one
+ *      row at a time. Pnm_ppmread reads an entire image into a 2D array
+ *      before returning, which is more memory than the streaming
+ *      compressor needs; the reader here parses the same header and then
+ *      hands back rows on demand. Badly formatted input raises
+ *      Pnm_Badformat, just as Pnm_ppmread does. ppm_reader_next moves a
+ *      reader on to the next of several images written one after another,
+ *      keeping its row buffer when the rows are no wider.
+ *      ppm_write_header starts the same raw pixmap that Pnm_ppmwrite does
+ *      for an image with a denominator of 255, and ppm_check reads an
+ *      image through without raising, for callers that cannot TRY.
+ *
+ ******************************************************************************/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <except.h>
+#include <mem.h>
+#include "assert.h"
+#include "ppmio.h"
+#include "stats.h"
+
+/********** scan_num ********
+ *
+ * Reads one unsigned decimal number from a pnm header or plain raster,
+ * skipping any whitespace and comments in front of it
+ *
+ * Inputs:
+ *      FILE *fp:       the file being read
+ *      unsigned *n:    receives the number that was read
+ *
+ * Return:
+ *      false if no number is found
+ *
+ * Notes:
+ *      The single character following the number is consumed, which is
+ *      what the format requires after the maxval of a raw pixmap
+ ************************/
+static bool scan_num(FILE *fp, unsigned *n)
+{
+        int c = getc(fp);
+
+        while (isspace(c) || c == '#') {
+                if (c == '#') {
+                        while (c != '\n' && c != EOF) {
+                                c = getc(fp);
+                        }
+                }
+                c = getc(fp);
+        }
+
+        if (!isdigit(c)) {
+                return false;
+        }
+
+        *n = 0;
+        while (isdigit(c)) {
+                *n = *n * 10 + (c - '0');
+                c = getc(fp);
+        }
+
+        return true;
+}
+
+/********** read_header_num ********
+ *
+ * Reads one unsigned decimal number from a pnm header or plain raster,
+ * as scan_num does
+ *
+ * Inputs:
+ *      FILE *fp: the file being read
+ *
+ * Return:
+ *      the number that was read
+ *
+ * Expects:
+ *      the next token in the file to be a number
+ *
+ * Notes:
+ *      Raises Pnm_Badformat if no number is found
+ ************************/
+static unsigned read_header_num(FILE *fp)
+{
+        unsigned n;
+        if (!scan_num(fp, &n)) {
+                RAISE(Pnm_Badformat);
+        }
+        return n;
+}
+
+/********** read_header ********
+ *
+ * Reads the header of a portable pixmap into a reader and makes sure the
+ * reader has room for one raw row of the image
+ *
+ * Inputs:
+ *      ppm_reader reader: the reader, whose file is at the start of an
+ *                         image
+ *
+ * Notes:
+ *      Raises Pnm_Badformat if the header is not a P3 or P6 header
+ *      The raw row buffer is only reallocated when it is too small
+ ************************/
+static void read_header(ppm_reader reader)
+{
+        FILE *fp = reader->fp;
+        if (getc(fp) != 'P') {
+                RAISE(Pnm_Badformat);
+        }
+        int kind = getc(fp);
+        if (kind != '3' && kind != '6') {
+                RAISE(Pnm_Badformat);
+        }
+
+        reader->plain = (kind == '3');
+        reader->width = read_header_num(fp);
+        reader->height = read_header_num(fp);
+        reader->denominator = read_header_num(fp);
+        if (reader->denominator == 0 || reader->denominator > 65535) {
+                RAISE(Pnm_Badformat);
+        }
+
+        /* raw samples take two bytes once the maxval no longer fits in one */
+        int bytes_per_sample = reader->denominator < 256 ? 1 : 2;
+        size_t raw_size = 3 * bytes_per_sample * (size_t)reader->width + 1;
+        if (raw_size > reader->raw_size) {
+                if (reader->raw != NULL) {
+                        FREE(reader->raw);
+                }
+                reader->raw = ALLOC(raw_size);
+                stats_allocation(raw_size);
+                reader->raw_size = raw_size;
+        }
+}
+
+/********** ppm_reader_new ********
+ *
+ * Reads the header of a portable pixmap and returns a reader positioned
+ * at the first row of pixels
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding a PPM image
+ *
+ * Return:
+ *      a ppm_reader holding the dimensions and denominator of the image
+ *
+ * Expects:
+ *      fp to be a valid pointer to an open input file
+ *
+ * Notes:
+ *      Memory is allocated for the reader, it is freed by ppm_reader_free
+ *      Raises Pnm_Badformat if the header is not a P3 or P6 header
+ ************************/
+ppm_reader ppm_reader_new(FILE *fp)
+{
+        assert(fp);
+        ppm_reader reader = NEW(reader);
+        stats_allocation(sizeof(*reader));
+        reader->fp = fp;
+        reader->raw = NULL;
+        reader->raw_size = 0;
+        read_header(reader);
+        return reader;
+}
+
+/********** ppm_reader_next ********
+ *
+ * Moves a reader on to the next image in its file, as in a stream of
+ * images written one after another
+ *
+ * Inputs:
+ *      ppm_reader reader: the reader
+ *
+ * Return:
+ *      true if there was another image, whose header has been read;
+ *      false if nothing but whitespace was left in the file
+ *
+ * Expects:
+ *      every row of the current image to have been read
+ *
+ * Notes:
+ *      Raises Pnm_Badformat if the next header is not a P3 or P6 header
+ ************************/
+bool ppm_reader_next(ppm_reader reader)
+{
+        assert(reader);
+        int c = getc(reader->fp);
+        while (isspace(c)) {
+                c = getc(reader->fp);
+        }
+        if (c == EOF) {
+                return false;
+        }
+        ungetc(c, reader->fp);
+        read_header(reader);
+        return true;
+}
+
+/********** ppm_reader_free ********
+ *
+ * Frees a reader allocated by ppm_reader_new
+ *
+ * Inputs:
+ *      ppm_reader *reader: pointer to the reader being freed
+ *
+ * Expects:
+ *      reader and *reader to not be null
+ *
+ * Notes:
+ *      The underlying file is not closed
+ ************************/
+void ppm_reader_free(ppm_reader *reader)
+{
+        assert(reader && *reader);
+        FREE((*reader)->raw);
+        FREE(*reader);
+}
+
+/********** ppm_read_row ********
+ *
+ * Reads the next row of pixels from a portable pixmap
+ *
+ * Inputs:
+ *      ppm_reader reader:      the reader for the image
+ *      struct rgb16 *row:      array of at least reader->width pixels that
+ *                              is filled with the row
+ *
+ * Expects:
+ *      Fewer than reader->height rows to have been read already
+ *
+ * Notes:
+ *      Raises Pnm_Badformat if the file ends before the row is complete
+ ************************/
+void ppm_read_row(ppm_reader reader, struct rgb16 *row)
+{
+        assert(reader && row);
+        unsigned width = reader->width;
+
+        if (reader->plain) {
+                for (unsigned i = 0; i < width; i++) {
+                        row[i].red = read_header_num(reader->fp);
+                        row[i].green = read_header_num(reader->fp);
+                        row[i].blue = read_header_num(reader->fp);
+                }
+                return;
+        }
+
+        unsigned char *raw = reader->raw;
+        if (reader->denominator < 256) {
+                if (fread(raw, 3, width, reader->fp) != width) {
+                        RAISE(Pnm_Badformat);
+                }
+                for (unsigned i = 0; i < width; i++) {
+                        row[i].red = raw[3 * i];
+                        row[i].green = raw[3 * i + 1];
+                        row[i].blue = raw[3 * i + 2];
+                }
+        } else {
+                /* two byte samples are stored most significant byte first */
+                if (fread(raw, 6, width, reader->fp) != width) {
+                        RAISE(Pnm_Badformat);
+                }
+                for (unsigned i = 0; i < width; i++) {
+                        unsigned char *s = raw + 6 * i;
+                        row[i].red = (s[0] << 8) | s[1];
+                        row[i].green = (s[2] << 8) | s[3];
+                        row[i].blue = (s[4] << 8) | s[5];
+                }
+        }
+}
+
+/********** ppm_read_row8 ********
+ *
+ * Reads the next row of pixels from a raw portable pixmap with one byte
+ * samples, straight into the row, which has the same layout
+ *
+ * Inputs:
+ *      ppm_reader reader:      the reader for the image
+ *      struct rgb8 *row:       array of at least reader->width pixels that
+ *                              is filled with the row
+ *
+ * Expects:
+ *      Fewer than reader->height rows to have been read already, the image
+ *      to be raw and its denominator to be at most 255
+ *
+ * Notes:
+ *      Raises Pnm_Badformat if the file ends before the row is complete
+ ************************/
+void ppm_read_row8(ppm_reader reader, struct rgb8 *row)
+{
+        assert(reader && row);
+        assert(!reader->plain && reader->denominator < 256);
+        if (fread(row, 3, reader->width, reader->fp) != reader->width) {
+                RAISE(Pnm_Badformat);
+        }
+}
+
+/********** check_image ********
+ *
+ * Reads through a portable pixmap without keeping it, to see whether a
+ * reader would read it without raising Pnm_Badformat
+ *
+ * Inputs:
+ *      FILE *fp: the file, at the start of an image
+ *
+ * Return:
+ *      true if the header is a P3 or P6 header and every sample follows
+ ************************/
+static bool check_image(FILE *fp)
+{
+        unsigned width, height, denominator;
+        if (getc(fp) != 'P') {
+                return false;
+        }
+        int kind = getc(fp);
+        if ((kind != '3' && kind != '6') || !scan_num(fp, &width) ||
+            !scan_num(fp, &height) || !scan_num(fp, &denominator) ||
+            denominator == 0 || denominator > 65535) {
+                return false;
+        }
+
+        uint64_t samples = 3 * (uint64_t)width * height;
+        if (kind == '3') {
+                unsigned sample;
+                for (uint64_t i = 0; i < samples; i++) {
+                        if (!scan_num(fp, &sample)) {
+                                return false;
+                        }
+                }
+                return true;
+        }
+
+        /* a raw raster is only as long as its last byte */
+        uint64_t bytes = samples * (denominator < 256 ? 1 : 2);
+        if (bytes == 0) {
+                return true;
+        }
+        return bytes - 1 <= INT64_MAX &&
+               fseeko(fp, (off_t)(bytes - 1), SEEK_CUR) == 0 &&
+               getc(fp) != EOF;
+}
+
+/********** ppm_check ********
+ *
+ * Checks that a file holds a whole portable pixmap, without raising
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding a PPM image
+ *
+ * Return:
+ *      true if ppm_reader_new and ppm_read_row would read every row of
+ *      the image without raising Pnm_Badformat
+ *
+ * Expects:
+ *      fp to be open for reading and seekable
+ *
+ * Notes:
+ *      The file is left where it was; a plain pixmap is read through to
+ *      the end, so it is parsed twice
+ *      For batch mode, whose worker threads cannot TRY: the exception
+ *      stack of the CII is not per thread
+ ************************/
+bool ppm_check(FILE *fp)
+{
+        assert(fp);
+        off_t start = ftello(fp);
+        if (start < 0) {
+                return false;
+        }
+        bool ok = check_image(fp);
+        clearerr(fp);
+        return fseeko(fp, start, SEEK_SET) == 0 && ok;
+}
+
+/********** ppm_write_header ********
+ *
+ * Writes the header of a raw portable pixmap with a denominator of 255
+ *
+ * Inputs:
+ *      FILE *fp:               the file being written
+ *      unsigned width:         the width of the image
+ *      unsigned height:        the height of the image
+ *
+ * Expects:
+ *      fp to be open for writing
+ ************************/
+void ppm_write_header(FILE *fp, unsigned width, unsigned height)
+{
+        assert(fp);
+        fprintf(fp, "P6\n%u %u\n%u\n", width, height, 255);
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************
+ *
+ *                                  ppmio.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for ppmio.c. It declares a small reader that
+ *      pulls a portable pixmap from a file one row at a time, so that the
+ *      streaming compressor never has to hold the whole image in memory.
+ *      Both the plain (P3) and raw (P6) formats are supported.
+ *
+ ******************************************************************************/
+
+#ifndef PPMIO_INCLUDED
+#define PPMIO_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pnm.h>
+#include "struct_def.h"
+
+typedef struct ppm_reader {
+        FILE *fp;
+        unsigned width;
+        unsigned height;
+        unsigned denominator;
+        bool plain;                     /* P3 instead of P6 */
+        unsigned char *raw;             /* one raw row of samples */
+        size_t raw_size;                /* bytes allocated for raw */
+} *ppm_reader;
+
+ppm_reader ppm_reader_new(FILE *fp);
+void ppm_reader_free(ppm_reader *reader);
+bool ppm_reader_next(ppm_reader reader);
+void ppm_read_row(ppm_reader reader, struct rgb16 *row);
+void ppm_read_row8(ppm_reader reader, struct rgb8 *row);
+void ppm_write_header(FILE *fp, unsigned width, unsigned height);
+bool ppm_check(FILE *fp);
+
+#endif
@@ -0,0 +1,200 @@
+/*******************************************************************************
+ *
+ *                                  quant.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the dequantization tables for the decoder. Each
+ *      entry is computed exactly as word_to_comp_vid used to compute it
+ *      for every block, in double precision and then rounded to float, so
+ *      decoding through the tables gives the same pixels.
+ *
+ *      It also contains the encoder's chroma thresholds. Rather than
+ *      assume anything about how Arith40_index_of_chroma picks an index,
+ *      the thresholds are found by asking it: floats are ordered like
+ *      their bit patterns once the sign is accounted for, so a binary
+ *      search over bit patterns finds, for each index, the smallest float
+ *      that Arith40_index_of_chroma puts at that index or above. The
+ *      search covers [-1, 1], well past the [-0.5, 0.5] that the average
+ *      chroma of a block can take; far outside it, nearest-value lookups
+ *      lose precision and need not be monotonic.
+ *
+ ******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include <arith40.h>
+#include "codeword.h"
+#include "quant.h"
+
+static struct dequant_tables tables;
+static pthread_once_t tables_built = PTHREAD_ONCE_INIT;
+
+/* bound on the average chroma of a block that the thresholds cover */
+#define CHROMA_LIMIT 1.0f
+
+static float thresholds[CHROMA_THRESHOLDS];
+static pthread_once_t thresholds_found = PTHREAD_ONCE_INIT;
+
+/********** build_dequant_tables ********
+ *
+ * Fills in the dequantization tables
+ *
+ * Notes:
+ *      Run exactly once, through pthread_once, so that threads decoding at
+ *      the same time all see the finished tables
+ ************************/
+static void build_dequant_tables(void)
+{
+        for (int a = 0; a < 512; a++) {
+                tables.a[a] = a / 511.0;
+        }
+        for (int bits = 0; bits < 32; bits++) {
+                int value = bits < 16 ? bits : bits - 32;
+                tables.bcd[bits] = value / 50.0;
+        }
+        for (unsigned index = 0; index < 16; index++) {
+                tables.chroma[index] = Arith40_chroma_of_index(index);
+        }
+}
+
+/********** dequant_tables ********
+ *
+ * Returns the dequantization tables, building them on the first call
+ *
+ * Return:
+ *      the tables, which must not be changed
+ *
+ * Notes:
+ *      Safe to call from any thread
+ ************************/
+const struct dequant_tables *dequant_tables(void)
+{
+        pthread_once(&tables_built, build_dequant_tables);
+        return &tables;
+}
+
+/********** float_to_key ********
+ *
+ * Maps a float to an unsigned key that sorts in the same order
+ *
+ * Inputs:
+ *      float x: the float, which must not be NaN
+ *
+ * Return:
+ *      the key
+ ************************/
+static uint32_t float_to_key(float x)
+{
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+}
+
+/********** key_to_float ********
+ *
+ * Maps a key made by float_to_key back to its float
+ *
+ * Inputs:
+ *      uint32_t key: the key
+ *
+ * Return:
+ *      the float
+ ************************/
+static float key_to_float(uint32_t key)
+{
+        uint32_t bits = (key & 0x80000000) ? key & 0x7fffffff : ~key;
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        return x;
+}
+
+/********** find_chroma_thresholds ********
+ *
+ * Fills in the chroma thresholds by binary search over the floats from
+ * -CHROMA_LIMIT to CHROMA_LIMIT
+ *
+ * Notes:
+ *      Run exactly once, through pthread_once
+ *      An index that no float in range reaches gets a threshold of
+ *      infinity, which no block's chroma is at least
+ ************************/
+static void find_chroma_thresholds(void)
+{
+        for (unsigned k = 1; k <= CHROMA_THRESHOLDS; k++) {
+                uint32_t lo = float_to_key(-CHROMA_LIMIT);
+                uint32_t hi = float_to_key(CHROMA_LIMIT);
+                if (Arith40_index_of_chroma(CHROMA_LIMIT) < k) {
+                        thresholds[k - 1] = INFINITY;
+                        continue;
+                }
+                /* the smallest key in [lo, hi] whose index is at least k */
+                while (lo < hi) {
+                        uint32_t mid = lo + (hi - lo) / 2;
+                        if (Arith40_index_of_chroma(key_to_float(mid)) >= k) {
+                                hi = mid;
+                        } else {
+                                lo = mid + 1;
+                        }
+                }
+                thresholds[k - 1] = key_to_float(lo);
+        }
+}
+
+/********** chroma_thresholds ********
+ *
+ * Returns the chroma thresholds used by quantize_chroma, finding them on
+ * the first call
+ *
+ * Return:
+ *      CHROMA_THRESHOLDS floats in increasing order, which must not be
+ *      changed
+ *
+ * Notes:
+ *      Safe to call from any thread
+ ************************/
+const float *chroma_thresholds(void)
+{
+        pthread_once(&thresholds_found, find_chroma_thresholds);
+        return thresholds;
+}
+
+/********** quantize_block_row ********
+ *
+ * Quantizes and packs the code words of a row of blocks, given the sums
+ * of each block's four pixels
+ *
+ * Inputs:
+ *      const float *pb, *pr:           the sums of the blocks' Pb and Pr
+ *      const float *a, *b, *c, *d:     the sums of the blocks' Y values,
+ *                                      with the signs of each coefficient
+ *      unsigned count:                 the number of blocks
+ *      uint32_t *words:                receives count code words
+ *
+ * Expects:
+ *      No pointers to be null
+ *
+ * Notes:
+ *      Written without branches so that the compiler can vectorize the
+ *      loop; the code words are exactly those finalize_word and pack_word
+ *      would give
+ ************************/
+void quantize_block_row(const float *pb, const float *pr, const float *a,
+                        const float *b, const float *c, const float *d,
+                        unsigned count, uint32_t *words)
+{
+        const float *t = chroma_thresholds();
+
+        for (unsigned i = 0; i < count; i++) {
+                unsigned a_code = (a[i] / 4.0) * 511;
+                words[i] = CODEWORD_PUT(A, a_code) |
+                           CODEWORD_PUT(B, quantize_coefficient(b[i])) |
+                           CODEWORD_PUT(C, quantize_coefficient(c[i])) |
+                           CODEWORD_PUT(D, quantize_coefficient(d[i])) |
+                           CODEWORD_PUT(PB, quantize_chroma(t, pb[i] * 0.25f)) |
+                           CODEWORD_PUT(PR, quantize_chroma(t, pr[i] * 0.25f));
+        }
+}
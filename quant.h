@@ -0,0 +1,91 @@
+/*******************************************************************************
+ *
+ *                                  quant.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for quant.c. It declares the encoder's
+ *      quantizers and the tables that turn the quantized fields of a code
+ *      word back into the values the decoder works with. Every field has
+ *      at most 512 codes, so the divisions and chroma lookups are done
+ *      once, when the tables are built, instead of for every block.
+ *
+ *      The quantizers have no branches, so a compiler can run them over a
+ *      whole row of blocks with vector instructions. They give exactly the
+ *      codes that Arith40_index_of_chroma and clamping b, c and d to
+ *      [-0.3, 0.3] give.
+ *
+ ******************************************************************************/
+
+#ifndef QUANT_INCLUDED
+#define QUANT_INCLUDED
+
+#include <stdint.h>
+
+struct dequant_tables {
+        float a[512];           /* code a of the 9 bit field: a / 511.0 */
+        float bcd[32];          /* raw bits r of a 5 bit b, c or d field:
+                                   the signed value of r divided by 50.0 */
+        float chroma[16];       /* Arith40_chroma_of_index of each index */
+};
+
+const struct dequant_tables *dequant_tables(void);
+
+/*
+ * the chroma index of x is the number of thresholds x is at least; 
+ * threshold k - 1 is the smallest float whose index is k or more
+ */
+#define CHROMA_THRESHOLDS 15
+const float *chroma_thresholds(void);
+
+void quantize_block_row(const float *pb, const float *pr, const float *a,
+                        const float *b, const float *c, const float *d,
+                        unsigned count, uint32_t *words);
+
+/********** quantize_chroma ********
+ *
+ * Quantizes the average Pb or Pr of a block to a 4 bit chroma index
+ *
+ * Inputs:
+ *      const float *thresholds: the table from chroma_thresholds
+ *      float x:                 the average chroma of the block
+ *
+ * Return:
+ *      the same index as Arith40_index_of_chroma(x)
+ ************************/
+static inline unsigned quantize_chroma(const float *thresholds, float x)
+{
+        unsigned index = 0;
+        for (int k = 0; k < CHROMA_THRESHOLDS; k++) {
+                index += x >= thresholds[k];
+        }
+        return index;
+}
+
+/********** quantize_coefficient ********
+ *
+ * Quantizes a sum of four signed Y values, b, c or d, to a 5 bit code
+ *
+ * Inputs:
+ *      float sum: the sum of the block
+ *
+ * Return:
+ *      the average sum / 4, clamped to [-0.3, 0.3], times 50 and truncated
+ *      toward zero
+ *
+ * Notes:
+ *      The clamp was once done against the double 0.3; no float lies
+ *      between that and the float 0.3f, so clamping to 0.3f clamps the
+ *      same values
+ ************************/
+static inline int quantize_coefficient(float sum)
+{
+        float val = sum * 0.25f;
+        val = val > 0.3f ? 0.3f : val;
+        val = val < -0.3f ? -0.3f : val;
+        return val * 50;
+}
+
+#endif
@@ -0,0 +1,565 @@
+/*******************************************************************************
+ *
+ *                                  rans.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the entropy coder for strips of code words. A
+ *      strip is read as a sequence of tokens: a literal code word, or a
+ *      run of 1 to MAX_RUN copies of the code word before it, which is
+ *      what flat regions turn into. A literal is coded as its six fields,
+ *      with a replaced by its difference from the a of the code word
+ *      before, since smooth regions change brightness slowly. Tokens and
+ *      each field have their own model, a table of frequencies counted
+ *      over the strip and stored ahead of it.
+ *
+ *      The symbols are coded with rANS, one 32 bit state renormalized a
+ *      byte at a time, as in Fabian Giesen's public domain ryg_rans. The
+ *      encoder runs backwards over the strip so the decoder can run
+ *      forwards, and the decoder finds each symbol with one table lookup
+ *      on the low bits of its state.
+ *
+ *      A coded strip starts with a mode byte. When coding would not make
+ *      the strip smaller, as with noise, the code words are stored raw
+ *      instead, so no strip ever grows by more than that byte.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "codeword.h"
+#include "rans.h"
+
+/* the low end of the state's normalized interval */
+#define RANS_LOW (UINT32_C(1) << 23)
+
+/* the longest run one token codes */
+#define MAX_RUN 16
+
+/* the mode byte at the start of a coded strip */
+enum { MODE_RAW, MODE_RANS };
+
+enum { MODEL_TOKEN, MODEL_A, MODEL_B, MODEL_C, MODEL_D, MODEL_PB, MODEL_PR };
+
+/* symbols in each model: a token is 0 for a literal or the run length */
+static const unsigned alphabet[RANS_MODELS] = {
+        MAX_RUN + 1, 1 << CODEWORD_A_WIDTH, 1 << CODEWORD_B_WIDTH,
+        1 << CODEWORD_C_WIDTH, 1 << CODEWORD_D_WIDTH, 1 << CODEWORD_PB_WIDTH,
+        1 << CODEWORD_PR_WIDTH
+};
+
+/* the most bytes the tables take, at two bytes per symbol */
+#define TABLE_BYTES (2 * (MAX_RUN + 1 + 512 + 3 * 32 + 2 * 16))
+
+/********** literal_symbols ********
+ *
+ * Splits a literal code word into the symbols of its fields
+ *
+ * Inputs:
+ *      uint32_t word:          the code word
+ *      uint32_t previous:      the code word before it, or 0 for the first
+ *      unsigned symbols[]:     receives one symbol per field model
+ ************************/
+static void literal_symbols(uint32_t word, uint32_t previous,
+                            unsigned symbols[RANS_MODELS])
+{
+        symbols[MODEL_A] = (CODEWORD_GETU(A, word) -
+                            CODEWORD_GETU(A, previous)) & CODEWORD_MASK(A);
+        symbols[MODEL_B] = CODEWORD_GETU(B, word);
+        symbols[MODEL_C] = CODEWORD_GETU(C, word);
+        symbols[MODEL_D] = CODEWORD_GETU(D, word);
+        symbols[MODEL_PB] = CODEWORD_GETU(PB, word);
+        symbols[MODEL_PR] = CODEWORD_GETU(PR, word);
+}
+
+/********** count_symbols ********
+ *
+ * Counts how often each symbol of each model occurs in a strip
+ *
+ * Inputs:
+ *      struct rans_encoder *e:         receives the counts
+ *      const uint32_t *words:          the strip's code words
+ *      size_t count:                   the number of code words
+ ************************/
+static void count_symbols(struct rans_encoder *e, const uint32_t *words,
+                          size_t count)
+{
+        memset(e->count, 0, sizeof(e->count));
+
+        size_t i = 0;
+        while (i < count) {
+                if (i > 0 && words[i] == words[i - 1]) {
+                        unsigned run = 1;
+                        while (run < MAX_RUN && i + run < count &&
+                               words[i + run] == words[i - 1]) {
+                                run++;
+                        }
+                        e->count[MODEL_TOKEN][run]++;
+                        i += run;
+                        continue;
+                }
+
+                unsigned symbols[RANS_MODELS];
+                literal_symbols(words[i], i > 0 ? words[i - 1] : 0, symbols);
+                e->count[MODEL_TOKEN][0]++;
+                for (int m = MODEL_A; m < RANS_MODELS; m++) {
+                        e->count[m][symbols[m]]++;
+                }
+                i++;
+        }
+}
+
+/********** normalize ********
+ *
+ * Scales the counts of one model to frequencies summing to RANS_SCALE
+ *
+ * Inputs:
+ *      struct rans_encoder *e: holds the counts, receives the frequencies
+ *                              and the start of each symbol's range
+ *      int m:                  the model
+ *
+ * Notes:
+ *      Every symbol that occurs keeps a frequency of at least 1; a model
+ *      with no symbols gets all zero frequencies
+ ************************/
+static void normalize(struct rans_encoder *e, int m)
+{
+        unsigned n = alphabet[m];
+        uint64_t total = 0;
+        for (unsigned s = 0; s < n; s++) {
+                total += e->count[m][s];
+        }
+
+        unsigned sum = 0, largest = 0;
+        for (unsigned s = 0; s < n; s++) {
+                unsigned freq = 0;
+                if (e->count[m][s] > 0) {
+                        freq = e->count[m][s] * (uint64_t)RANS_SCALE / total;
+                        freq = freq > 0 ? freq : 1;
+                }
+                e->freq[m][s] = freq;
+                sum += freq;
+                if (e->count[m][s] > e->count[m][largest]) {
+                        largest = s;
+                }
+        }
+
+        if (total > 0 && sum < RANS_SCALE) {
+                e->freq[m][largest] += RANS_SCALE - sum;
+        }
+        while (sum > RANS_SCALE) {
+                for (unsigned s = 0; s < n && sum > RANS_SCALE; s++) {
+                        if (e->freq[m][s] > 1) {
+                                e->freq[m][s]--;
+                                sum--;
+                        }
+                }
+        }
+
+        unsigned start = 0;
+        for (unsigned s = 0; s < n; s++) {
+                e->start[m][s] = start;
+                start += e->freq[m][s];
+        }
+}
+
+/********** put_varint ********
+ *
+ * Writes a number seven bits at a time, least significant first, with the
+ * top bit of each byte set when more follow
+ *
+ * Inputs:
+ *      unsigned char *p:       where the number is written
+ *      unsigned value:         the number
+ *
+ * Return:
+ *      the byte after the number
+ ************************/
+static unsigned char *put_varint(unsigned char *p, unsigned value)
+{
+        while (value >= 0x80) {
+                *p++ = (value & 0x7f) | 0x80;
+                value >>= 7;
+        }
+        *p++ = value;
+        return p;
+}
+
+/********** get_varint ********
+ *
+ * Reads a number written by put_varint
+ *
+ * Inputs:
+ *      const unsigned char **p:        the number, advanced past it
+ *      const unsigned char *end:       the end of the input
+ *      unsigned *value:                receives the number
+ *
+ * Return:
+ *      false if the input ends inside the number or it is too long
+ ************************/
+static bool get_varint(const unsigned char **p, const unsigned char *end,
+                       unsigned *value)
+{
+        *value = 0;
+        for (int shift = 0; shift < 21; shift += 7) {
+                if (*p == end) {
+                        return false;
+                }
+                unsigned char byte = *(*p)++;
+                *value |= (unsigned)(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+/********** put_table ********
+ *
+ * Writes the frequencies of one model: each frequency as a varint, and
+ * each run of absent symbols as a 0 byte and a varint of its length less
+ * one
+ *
+ * Inputs:
+ *      unsigned char *p:               where the table is written
+ *      const struct rans_encoder *e:   holds the frequencies
+ *      int m:                          the model
+ *
+ * Return:
+ *      the byte after the table
+ ************************/
+static unsigned char *put_table(unsigned char *p, const struct rans_encoder *e,
+                                int m)
+{
+        unsigned n = alphabet[m];
+        for (unsigned s = 0; s < n; ) {
+                if (e->freq[m][s] != 0) {
+                        p = put_varint(p, e->freq[m][s]);
+                        s++;
+                        continue;
+                }
+                unsigned run = 1;
+                while (s + run < n && e->freq[m][s + run] == 0) {
+                        run++;
+                }
+                *p++ = 0;
+                p = put_varint(p, run - 1);
+                s += run;
+        }
+        return p;
+}
+
+/********** get_table ********
+ *
+ * Reads the frequencies of one model and builds its decoding slots
+ *
+ * Inputs:
+ *      struct rans_decoder *d:         receives the slots
+ *      int m:                          the model
+ *      const unsigned char **p:        the table, advanced past it
+ *      const unsigned char *end:       the end of the input
+ *
+ * Return:
+ *      false unless the table is well formed and its frequencies sum to
+ *      RANS_SCALE, or to 0 for a model with no symbols
+ ************************/
+static bool get_table(struct rans_decoder *d, int m, const unsigned char **p,
+                      const unsigned char *end)
+{
+        unsigned n = alphabet[m];
+        unsigned start = 0;
+        for (unsigned s = 0; s < n; ) {
+                if (*p == end) {
+                        return false;
+                }
+                unsigned value;
+                if (**p == 0) {
+                        (*p)++;
+                        if (!get_varint(p, end, &value) || value >= n - s) {
+                                return false;
+                        }
+                        s += value + 1;
+                        continue;
+                }
+                if (!get_varint(p, end, &value) ||
+                    value > RANS_SCALE - start) {
+                        return false;
+                }
+                for (unsigned k = 0; k < value; k++) {
+                        d->slots[m][start + k] = (struct rans_slot){
+                                .symbol = s, .freq = value, .bias = k
+                        };
+                }
+                start += value;
+                s++;
+        }
+
+        d->empty[m] = start == 0;
+        return start == 0 || start == RANS_SCALE;
+}
+
+/********** put_symbol ********
+ *
+ * Encodes one symbol into the rANS state, emitting bytes backwards
+ *
+ * Inputs:
+ *      uint32_t *x:                    the state
+ *      unsigned char **p:              the last byte emitted, moved back
+ *      const unsigned char *limit:     the first byte that may be written
+ *      unsigned start, freq:           the symbol's range in its model
+ *
+ * Return:
+ *      false if the output would pass limit
+ ************************/
+static inline bool put_symbol(uint32_t *x, unsigned char **p,
+                              const unsigned char *limit, unsigned start,
+                              unsigned freq)
+{
+        uint32_t x_max = ((RANS_LOW >> RANS_SCALE_BITS) << 8) * freq;
+        while (*x >= x_max) {
+                if (*p == limit) {
+                        return false;
+                }
+                *--(*p) = *x & 0xff;
+                *x >>= 8;
+        }
+        *x = ((*x / freq) << RANS_SCALE_BITS) + *x % freq + start;
+        return true;
+}
+
+/********** get_symbol ********
+ *
+ * Decodes one symbol from the rANS state, reading bytes forwards
+ *
+ * Inputs:
+ *      const struct rans_slot *slots:  the model's slots
+ *      uint32_t *x:                    the state
+ *      const unsigned char **p:        the next byte, advanced
+ *      const unsigned char *end:       the end of the input
+ *      unsigned *symbol:               receives the symbol
+ *
+ * Return:
+ *      false if the input runs out
+ ************************/
+static inline bool get_symbol(const struct rans_slot *slots, uint32_t *x,
+                              const unsigned char **p,
+                              const unsigned char *end, unsigned *symbol)
+{
+        const struct rans_slot *slot = &slots[*x & (RANS_SCALE - 1)];
+        *x = slot->freq * (*x >> RANS_SCALE_BITS) + slot->bias;
+        while (*x < RANS_LOW) {
+                if (*p == end) {
+                        return false;
+                }
+                *x = *x << 8 | *(*p)++;
+        }
+        *symbol = slot->symbol;
+        return true;
+}
+
+/********** encode_tokens ********
+ *
+ * Encodes a strip's tokens, last first, into the rANS state
+ *
+ * Inputs:
+ *      const struct rans_encoder *e:   the models
+ *      const uint32_t *words:          the strip's code words
+ *      size_t count:                   the number of code words
+ *      uint32_t *x:                    the state
+ *      unsigned char **p:              the last byte emitted, moved back
+ *      const unsigned char *limit:     the first byte that may be written
+ *
+ * Return:
+ *      false if the output would pass limit
+ *
+ * Notes:
+ *      Runs are split into tokens exactly as count_symbols and the decoder
+ *      split them, MAX_RUN at a time from the front
+ ************************/
+static bool encode_tokens(const struct rans_encoder *e, const uint32_t *words,
+                          size_t count, uint32_t *x, unsigned char **p,
+                          const unsigned char *limit)
+{
+#define PUT(m, symbol) \
+        put_symbol(x, p, limit, e->start[m][symbol], e->freq[m][symbol])
+
+        size_t i = count;
+        while (i > 0) {
+                size_t last = i - 1;
+                if (last > 0 && words[last] == words[last - 1]) {
+                        size_t first = last;
+                        while (first > 1 && words[first - 1] ==
+                                            words[first - 2]) {
+                                first--;
+                        }
+                        size_t length = last - first + 1;
+                        if (length % MAX_RUN != 0 &&
+                            !PUT(MODEL_TOKEN, length % MAX_RUN)) {
+                                return false;
+                        }
+                        for (size_t q = length / MAX_RUN; q > 0; q--) {
+                                if (!PUT(MODEL_TOKEN, MAX_RUN)) {
+                                        return false;
+                                }
+                        }
+                        i = first;
+                        continue;
+                }
+
+                unsigned symbols[RANS_MODELS];
+                literal_symbols(words[last], last > 0 ? words[last - 1] : 0,
+                                symbols);
+                for (int m = RANS_MODELS - 1; m > MODEL_TOKEN; m--) {
+                        if (!PUT(m, symbols[m])) {
+                                return false;
+                        }
+                }
+                if (!PUT(MODEL_TOKEN, 0)) {
+                        return false;
+                }
+                i = last;
+        }
+        return true;
+#undef PUT
+}
+
+/********** rans_encode ********
+ *
+ * Codes a strip of code words
+ *
+ * Inputs:
+ *      struct rans_encoder *encoder:   working tables
+ *      const uint32_t *words:          the code words
+ *      size_t count:                   the number of code words
+ *      unsigned char *out:             receives the coded strip, with
+ *                                      room for RANS_BOUND(count) bytes
+ *
+ * Return:
+ *      the size of the coded strip
+ *
+ * Notes:
+ *      Falls back to the raw code words when coding does not shrink them
+ ************************/
+size_t rans_encode(struct rans_encoder *encoder, const uint32_t *words,
+                   size_t count, unsigned char *out)
+{
+        unsigned char tables[TABLE_BYTES];
+        unsigned char *end_of_tables = tables;
+
+        count_symbols(encoder, words, count);
+        for (int m = 0; m < RANS_MODELS; m++) {
+                normalize(encoder, m);
+                end_of_tables = put_table(end_of_tables, encoder, m);
+        }
+        size_t table_bytes = end_of_tables - tables;
+
+        /* the coded symbols are written backwards from the end of out */
+        unsigned char *end = out + RANS_BOUND(count);
+        unsigned char *limit = out + 1 + table_bytes + 4;
+        unsigned char *p = end;
+        uint32_t x = RANS_LOW;
+        if (limit < end && encode_tokens(encoder, words, count, &x, &p,
+                                         limit)) {
+                p -= 4;
+                for (int k = 0; k < 4; k++) {
+                        p[k] = x >> (24 - 8 * k);
+                }
+                size_t coded = end - p;
+                out[0] = MODE_RANS;
+                memcpy(out + 1, tables, table_bytes);
+                memmove(out + 1 + table_bytes, p, coded);
+                return 1 + table_bytes + coded;
+        }
+
+        out[0] = MODE_RAW;
+        codewords_to_bytes(words, count, out + 1);
+        return RANS_BOUND(count);
+}
+
+/********** rans_decode ********
+ *
+ * Decodes a strip coded by rans_encode
+ *
+ * Inputs:
+ *      struct rans_decoder *decoder:   working tables
+ *      const unsigned char *in:        the coded strip
+ *      size_t size:                    the number of bytes in it
+ *      uint32_t *words:                receives the code words
+ *      size_t count:                   the number of code words expected
+ *
+ * Return:
+ *      false if the strip is malformed or does not hold exactly count
+ *      code words
+ ************************/
+bool rans_decode(struct rans_decoder *decoder, const unsigned char *in,
+                 size_t size, uint32_t *words, size_t count)
+{
+        if (size == 0) {
+                return false;
+        }
+        if (in[0] == MODE_RAW) {
+                if (size != RANS_BOUND(count)) {
+                        return false;
+                }
+                codewords_from_bytes(in + 1, count, words);
+                return true;
+        }
+        if (in[0] != MODE_RANS) {
+                return false;
+        }
+
+        const unsigned char *p = in + 1;
+        const unsigned char *end = in + size;
+        for (int m = 0; m < RANS_MODELS; m++) {
+                if (!get_table(decoder, m, &p, end)) {
+                        return false;
+                }
+        }
+        if (end - p < 4) {
+                return false;
+        }
+        uint32_t x = (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+        p += 4;
+        if (x < RANS_LOW) {
+                return false;
+        }
+
+        struct rans_slot (*slots)[RANS_SCALE] = decoder->slots;
+        size_t i = 0;
+        while (i < count) {
+                unsigned token;
+                if (decoder->empty[MODEL_TOKEN] ||
+                    !get_symbol(slots[MODEL_TOKEN], &x, &p, end, &token)) {
+                        return false;
+                }
+                if (token > 0) {
+                        if (i == 0 || token > count - i) {
+                                return false;
+                        }
+                        for (size_t k = 0; k < token; k++, i++) {
+                                words[i] = words[i - 1];
+                        }
+                        continue;
+                }
+
+                unsigned symbols[RANS_MODELS];
+                for (int m = MODEL_A; m < RANS_MODELS; m++) {
+                        if (decoder->empty[m] ||
+                            !get_symbol(slots[m], &x, &p, end,
+                                        &symbols[m])) {
+                                return false;
+                        }
+                }
+                uint32_t previous = i > 0 ? words[i - 1] : 0;
+                words[i++] = CODEWORD_PUT(A, CODEWORD_GETU(A, previous) +
+                                             symbols[MODEL_A]) |
+                             CODEWORD_PUT(B, symbols[MODEL_B]) |
+                             CODEWORD_PUT(C, symbols[MODEL_C]) |
+                             CODEWORD_PUT(D, symbols[MODEL_D]) |
+                             CODEWORD_PUT(PB, symbols[MODEL_PB]) |
+                             CODEWORD_PUT(PR, symbols[MODEL_PR]);
+        }
+
+        return p == end && x == RANS_LOW;
+}
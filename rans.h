@@ -0,0 +1,59 @@
+/*******************************************************************************
+ *
+ *                                  rans.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for rans.c. It declares the entropy coder
+ *      behind format 3's "rans" coding, which codes a strip of code words
+ *      field by field with rANS, each field with its own frequency table,
+ *      and codes runs of repeated code words as a single symbol.
+ *
+ *      The working tables are kept in structs the caller allocates, so
+ *      strips can be coded on worker threads without allocating.
+ *
+ ******************************************************************************/
+
+#ifndef RANS_INCLUDED
+#define RANS_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* frequencies are scaled to sum to 1 << RANS_SCALE_BITS */
+#define RANS_SCALE_BITS 12
+#define RANS_SCALE (1 << RANS_SCALE_BITS)
+
+/* one model per field, plus one for literal or run */
+#define RANS_MODELS 7
+#define RANS_MAX_SYMBOLS 512
+
+struct rans_encoder {
+        uint32_t count[RANS_MODELS][RANS_MAX_SYMBOLS];
+        uint16_t freq[RANS_MODELS][RANS_MAX_SYMBOLS];
+        uint16_t start[RANS_MODELS][RANS_MAX_SYMBOLS];
+};
+
+/* what a decoder state's low bits select: symbol, its frequency and the
+   distance from the start of its range */
+struct rans_slot {
+        uint16_t symbol, freq, bias;
+};
+
+struct rans_decoder {
+        bool empty[RANS_MODELS];        /* no symbols in the strip */
+        struct rans_slot slots[RANS_MODELS][RANS_SCALE];
+};
+
+/* the most bytes rans_encode writes for count code words */
+#define RANS_BOUND(count) (1 + 4 * (size_t)(count))
+
+size_t rans_encode(struct rans_encoder *encoder, const uint32_t *words,
+                   size_t count, unsigned char *out);
+bool rans_decode(struct rans_decoder *decoder, const unsigned char *in,
+                 size_t size, uint32_t *words, size_t count);
+
+#endif
@@ -0,0 +1,205 @@
+/*******************************************************************************
+ *
+ *                                  scratch.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the scratch allocator. Each compression or
+ *      decompression makes one scratch, takes every array and buffer it
+ *      needs from it, and frees the scratch when it is done, so the codec
+ *      makes a fixed handful of allocations per image no matter its size
+ *      and has nothing to free piece by piece.
+ *
+ *      A scratch carves its allocations out of chunks it mallocs itself,
+ *      CHUNK_BYTES at a time or one chunk for an allocation too big for
+ *      that, the way Hanson's arenas do; keeping the chunks here lets
+ *      each malloc be counted as a heap allocation for 40image --stats,
+ *      along with the calls to scratch_alloc and scratch_calloc.
+ *
+ *      A scratch's chunks are its own, so only the counts are shared,
+ *      and they are guarded by one lock. A scratch takes only a handful
+ *      of allocations per image, so threads that each use their own
+ *      scratch, as batch mode's do, hardly ever wait on it.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string.h>
+#include <mem.h>
+#include "assert.h"
+#include "scratch.h"
+#include "stats.h"
+
+/* the least a scratch mallocs at once */
+#define CHUNK_BYTES (64 * 1024)
+
+/* a block of memory allocations are carved from, followed by its bytes */
+struct chunk {
+        struct chunk *next;             /* the chunk malloced before it */
+        char *avail, *limit;            /* its bytes not yet handed out */
+};
+
+struct scratch {
+        struct chunk *chunks;           /* the newest first */
+};
+
+/* counts for every scratch made so far */
+static struct scratch_stats totals;
+
+/* guards totals */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/********** scratch_new ********
+ *
+ * Makes an empty scratch
+ *
+ * Return:
+ *      the scratch
+ *
+ * Notes:
+ *      Memory is allocated for the scratch, it is freed by scratch_free
+ ************************/
+scratch scratch_new(void)
+{
+        scratch s;
+        NEW(s);
+        stats_allocation(sizeof(*s));
+        s->chunks = NULL;
+        pthread_mutex_lock(&lock);
+        totals.scratches++;
+        pthread_mutex_unlock(&lock);
+        return s;
+}
+
+/********** scratch_free ********
+ *
+ * Frees a scratch along with everything allocated from it
+ *
+ * Inputs:
+ *      scratch *s: pointer to the scratch, set to NULL
+ *
+ * Expects:
+ *      s and *s to not be null
+ ************************/
+void scratch_free(scratch *s)
+{
+        assert(s && *s);
+        struct chunk *chunk = (*s)->chunks;
+        while (chunk != NULL) {
+                struct chunk *next = chunk->next;
+                FREE(chunk);
+                chunk = next;
+        }
+        FREE(*s);
+}
+
+/********** new_chunk ********
+ *
+ * Mallocs a chunk for a scratch, big enough for one allocation
+ *
+ * Inputs:
+ *      scratch s:      the scratch, which takes the chunk as its newest
+ *      size_t nbytes:  the bytes of the allocation
+ *
+ * Notes:
+ *      Whatever the scratch's last chunk had left is not used again
+ ************************/
+static void new_chunk(scratch s, size_t nbytes)
+{
+        size_t size = nbytes + SCRATCH_ALIGNMENT;
+        if (size < CHUNK_BYTES) {
+                size = CHUNK_BYTES;
+        }
+        struct chunk *chunk = ALLOC(sizeof(*chunk) + size);
+        stats_allocation(sizeof(*chunk) + size);
+        chunk->next = s->chunks;
+        chunk->avail = (char *)(chunk + 1);
+        chunk->limit = chunk->avail + size;
+        s->chunks = chunk;
+}
+
+/********** scratch_alloc ********
+ *
+ * Allocates memory from a scratch
+ *
+ * Inputs:
+ *      scratch s:      the scratch
+ *      size_t nbytes:  the number of bytes wanted
+ *
+ * Return:
+ *      a pointer to nbytes uninitialized bytes, aligned to
+ *      SCRATCH_ALIGNMENT, that stay valid until the scratch is freed
+ *
+ * Expects:
+ *      s to not be null
+ *
+ * Notes:
+ *      Zero bytes may be asked for; the pointer is still unique
+ ************************/
+void *scratch_alloc(scratch s, size_t nbytes)
+{
+        assert(s);
+        assert(nbytes < SIZE_MAX - CHUNK_BYTES);
+        size_t taken = nbytes > 0 ? nbytes : 1;
+        struct chunk *chunk = s->chunks;
+        if (chunk == NULL || (size_t)(chunk->limit - chunk->avail) <
+                             taken + SCRATCH_ALIGNMENT) {
+                new_chunk(s, taken);
+                chunk = s->chunks;
+        }
+
+        uintptr_t start = ((uintptr_t)chunk->avail + SCRATCH_ALIGNMENT - 1) &
+                          ~(uintptr_t)(SCRATCH_ALIGNMENT - 1);
+        char *p = chunk->avail + (start - (uintptr_t)chunk->avail);
+        chunk->avail = p + taken;
+
+        pthread_mutex_lock(&lock);
+        totals.allocations++;
+        totals.bytes += nbytes;
+        pthread_mutex_unlock(&lock);
+        return p;
+}
+
+/********** scratch_calloc ********
+ *
+ * Allocates zeroed memory for an array from a scratch
+ *
+ * Inputs:
+ *      scratch s:      the scratch
+ *      size_t count:   the number of elements
+ *      size_t nbytes:  the size of each element
+ *
+ * Return:
+ *      a pointer to count * nbytes zero bytes, aligned as by scratch_alloc
+ *
+ * Expects:
+ *      s to not be null
+ ************************/
+void *scratch_calloc(scratch s, size_t count, size_t nbytes)
+{
+        assert(nbytes == 0 || count <= SIZE_MAX / nbytes);
+        void *p = scratch_alloc(s, count * nbytes);
+        memset(p, 0, count * nbytes);
+        return p;
+}
+
+/********** scratch_totals ********
+ *
+ * Reports the allocation counts of every scratch made so far
+ *
+ * Inputs:
+ *      struct scratch_stats *stats: receives the counts
+ *
+ * Expects:
+ *      stats to not be null
+ ************************/
+void scratch_totals(struct scratch_stats *stats)
+{
+        assert(stats);
+        pthread_mutex_lock(&lock);
+        *stats = totals;
+        pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,45 @@
+/*******************************************************************************
+ *
+ *                                  scratch.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for scratch.c, the allocator for the
+ *      intermediate arrays and buffers of one compression or
+ *      decompression. A scratch is an arena, in the manner of Hanson's
+ *      Arena_T, that hands out cache line aligned memory and counts what
+ *      it hands out; everything taken from it is released at once by
+ *      scratch_free.
+ *
+ *      A scratch is not safe to allocate from on more than one thread at
+ *      a time. Memory for worker threads is allocated before it is handed
+ *      to them. Different threads may each use their own scratch at once.
+ *
+ ******************************************************************************/
+
+#ifndef SCRATCH_INCLUDED
+#define SCRATCH_INCLUDED
+
+#include <stddef.h>
+
+/* every allocation starts on a cache line */
+#define SCRATCH_ALIGNMENT 64
+
+typedef struct scratch *scratch;
+
+/* allocation counts for every scratch made so far */
+struct scratch_stats {
+        unsigned long scratches;        /* scratches made */
+        unsigned long allocations;      /* calls to scratch_alloc/calloc */
+        size_t bytes;                   /* bytes asked for */
+};
+
+scratch scratch_new(void);
+void scratch_free(scratch *s);
+void *scratch_alloc(scratch s, size_t nbytes);
+void *scratch_calloc(scratch s, size_t count, size_t nbytes);
+void scratch_totals(struct scratch_stats *stats);
+
+#endif
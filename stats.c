@@ -0,0 +1,302 @@
+/*******************************************************************************
+ *
+ *                                  stats.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the timings and counts reported by 40image
+ *      --stats. Each stage is charged the wall time on the monotonic clock
+ *      and the CPU time of the thread that timed it, so stages timed at
+ *      once on several threads, as in batch mode, are each charged only
+ *      their own work. A stage that hands its work to jobs on worker
+ *      threads is charged the wall time of the thread waiting on them and
+ *      the CPU each job spent on its own thread, so its CPU can be more
+ *      than its wall time; the total is the CPU time of the whole
+ *      process. The totals are guarded by one lock, taken only while
+ *      stats are enabled.
+ *
+ *      Bytes read and written are the process's own counts from
+ *      /proc/self/io, which take in every path whether it reads with
+ *      stdio or pread, and peak RSS is from getrusage. Heap allocations
+ *      are counted by stats_allocation where the codec mallocs; what the
+ *      C library mallocs for itself, for stdio buffers or thread stacks,
+ *      is not.
+ *
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+
+bool stats_enabled;
+
+static const char *stage_names[STATS_STAGES] = {
+        [STATS_READ] = "read", [STATS_COLOR] = "color",
+        [STATS_CODE] = "code", [STATS_WRITE] = "write"
+};
+
+static struct {
+        struct stats_clock start;       /* when stats were enabled */
+        uint64_t read_bytes, written_bytes;     /* by then */
+        struct stats_clock stages[STATS_STAGES];
+        bool charged[STATS_STAGES];
+        uint64_t counters[STATS_COUNTERS];
+} totals;
+
+/* guards totals */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/********** nanoseconds ********
+ *
+ * Inputs:
+ *      clockid_t id: the clock
+ *
+ * Return:
+ *      the time on a clock in nanoseconds
+ ************************/
+static uint64_t nanoseconds(clockid_t id)
+{
+        struct timespec t;
+        clock_gettime(id, &t);
+        return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/********** io_bytes ********
+ *
+ * Reads the bytes the process has read and written so far
+ *
+ * Inputs:
+ *      uint64_t *read:         receives the bytes read
+ *      uint64_t *written:      receives the bytes written
+ *
+ * Return:
+ *      false if /proc/self/io cannot be read
+ ************************/
+static bool io_bytes(uint64_t *read, uint64_t *written)
+{
+        FILE *fp = fopen("/proc/self/io", "r");
+        if (fp == NULL) {
+                return false;
+        }
+        int found = 0;
+        char line[64];
+        while (fgets(line, sizeof(line), fp) != NULL) {
+                found += sscanf(line, "rchar: %" SCNu64, read) == 1;
+                found += sscanf(line, "wchar: %" SCNu64, written) == 1;
+        }
+        fclose(fp);
+        return found == 2;
+}
+
+/********** process_clock_read ********
+ *
+ * Reads the wall clock and the CPU clock of the whole process
+ *
+ * Inputs:
+ *      struct stats_clock *clock: receives the times
+ ************************/
+static void process_clock_read(struct stats_clock *clock)
+{
+        clock->wall = nanoseconds(CLOCK_MONOTONIC);
+        clock->cpu = nanoseconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+/********** stats_enable ********
+ *
+ * Starts keeping stats, from this point on
+ ************************/
+void stats_enable(void)
+{
+        pthread_mutex_lock(&lock);
+        memset(&totals, 0, sizeof(totals));
+        io_bytes(&totals.read_bytes, &totals.written_bytes);
+        process_clock_read(&totals.start);
+        stats_enabled = true;
+        pthread_mutex_unlock(&lock);
+}
+
+/********** stats_clock_read ********
+ *
+ * Reads the wall clock and the CPU clock of the calling thread
+ *
+ * Inputs:
+ *      struct stats_clock *clock: receives the times
+ ************************/
+void stats_clock_read(struct stats_clock *clock)
+{
+        clock->wall = nanoseconds(CLOCK_MONOTONIC);
+        clock->cpu = nanoseconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/********** charge ********
+ *
+ * Charges a stage with the wall time, the CPU time or both since a clock
+ * was read, and reads it again
+ *
+ * Inputs:
+ *      stats_stage stage:              the stage
+ *      struct stats_clock *clock:      the time the stage started; receives
+ *                                      the time now
+ *      bool wall:                      whether the wall time is charged
+ *      bool cpu:                       whether the CPU time is charged
+ *
+ * Expects:
+ *      clock was read on the calling thread
+ ************************/
+static void charge(stats_stage stage, struct stats_clock *clock, bool wall,
+                   bool cpu)
+{
+        struct stats_clock now;
+        stats_clock_read(&now);
+        pthread_mutex_lock(&lock);
+        if (wall) {
+                totals.stages[stage].wall += now.wall - clock->wall;
+        }
+        if (cpu) {
+                totals.stages[stage].cpu += now.cpu - clock->cpu;
+        }
+        totals.charged[stage] = true;
+        pthread_mutex_unlock(&lock);
+        *clock = now;
+}
+
+/********** stats_clock_charge ********
+ *
+ * Charges a stage with the wall and CPU time since a clock was read, and
+ * reads it again
+ *
+ * Inputs:
+ *      stats_stage stage:              the stage
+ *      struct stats_clock *clock:      the time the stage started; receives
+ *                                      the time now
+ *
+ * Expects:
+ *      clock was read on the calling thread
+ ************************/
+void stats_clock_charge(stats_stage stage, struct stats_clock *clock)
+{
+        charge(stage, clock, true, true);
+}
+
+/********** stats_clock_charge_wall ********
+ *
+ * Charges a stage with only the wall time since a clock was read, and
+ * reads it again
+ *
+ * Inputs:
+ *      stats_stage stage:              the stage
+ *      struct stats_clock *clock:      the time the stage started; receives
+ *                                      the time now
+ *
+ * Expects:
+ *      clock was read on the calling thread
+ ************************/
+void stats_clock_charge_wall(stats_stage stage, struct stats_clock *clock)
+{
+        charge(stage, clock, true, false);
+}
+
+/********** stats_clock_charge_cpu ********
+ *
+ * Charges a stage with only the CPU time since a clock was read, and
+ * reads it again
+ *
+ * Inputs:
+ *      stats_stage stage:              the stage
+ *      struct stats_clock *clock:      the time the stage started; receives
+ *                                      the time now
+ *
+ * Expects:
+ *      clock was read on the calling thread
+ ************************/
+void stats_clock_charge_cpu(stats_stage stage, struct stats_clock *clock)
+{
+        charge(stage, clock, false, true);
+}
+
+/********** stats_counter_add ********
+ *
+ * Adds to a counter
+ *
+ * Inputs:
+ *      stats_counter counter:  the counter
+ *      uint64_t n:             the amount added
+ ************************/
+void stats_counter_add(stats_counter counter, uint64_t n)
+{
+        pthread_mutex_lock(&lock);
+        totals.counters[counter] += n;
+        pthread_mutex_unlock(&lock);
+}
+
+/********** report_time ********
+ *
+ * Reports one line of times
+ *
+ * Inputs:
+ *      FILE *fp:                       the file reported to
+ *      const char *name:               the stage, or "total"
+ *      const struct stats_clock *time: the wall and CPU time spent
+ *      uint64_t pixels:                the pixels handled in that time
+ ************************/
+static void report_time(FILE *fp, const char *name,
+                        const struct stats_clock *time, uint64_t pixels)
+{
+        fprintf(fp, "stats: %-5s wall %10.6f s, cpu %10.6f s", name,
+                time->wall / 1e9, time->cpu / 1e9);
+        if (pixels > 0 && time->wall > 0) {
+                fprintf(fp, ", %9.2f MP/s", pixels * 1e3 / time->wall);
+        }
+        fprintf(fp, "\n");
+}
+
+/********** stats_report ********
+ *
+ * Reports the stats kept since stats_enable
+ *
+ * Inputs:
+ *      FILE *fp: the file reported to
+ *
+ * Notes:
+ *      stdout is flushed first, so the bytes written count all of it
+ *      Stages that were never charged are left out
+ ************************/
+void stats_report(FILE *fp)
+{
+        fflush(stdout);
+        struct stats_clock total;
+        process_clock_read(&total);
+        uint64_t read_bytes, written_bytes;
+        bool io = io_bytes(&read_bytes, &written_bytes);
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        pthread_mutex_lock(&lock);
+        uint64_t pixels = totals.counters[STATS_PIXELS];
+        total.wall -= totals.start.wall;
+        total.cpu -= totals.start.cpu;
+        for (int stage = 0; stage < STATS_STAGES; stage++) {
+                if (totals.charged[stage]) {
+                        report_time(fp, stage_names[stage],
+                                    &totals.stages[stage], pixels);
+                }
+        }
+        report_time(fp, "total", &total, pixels);
+        fprintf(fp, "stats: %" PRIu64 " pixels, %" PRIu64 " code words\n",
+                pixels, totals.counters[STATS_CODEWORDS]);
+        fprintf(fp, "stats: %" PRIu64 " heap allocations, %" PRIu64
+                " bytes\n", totals.counters[STATS_ALLOCATIONS],
+                totals.counters[STATS_ALLOCATED_BYTES]);
+        if (io) {
+                fprintf(fp, "stats: %" PRIu64 " bytes read, %" PRIu64
+                        " bytes written\n", read_bytes - totals.read_bytes,
+                        written_bytes - totals.written_bytes);
+        }
+        fprintf(fp, "stats: peak RSS %ld KB\n", usage.ru_maxrss);
+        pthread_mutex_unlock(&lock);
+}
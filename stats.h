@@ -0,0 +1,168 @@
+/*******************************************************************************
+ *
+ *                                  stats.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for stats.c. It declares the timings and
+ *      counts reported by 40image --stats: the wall and CPU time spent in
+ *      each stage of the pipeline, the pixels and code words handled, and
+ *      the heap allocations made.
+ *
+ *      The calls made from the codec are inline and do nothing but test
+ *      one flag until stats_enable is called, so they are left in place
+ *      for every run. They are made once per image or per row, never per
+ *      pixel.
+ *
+ ******************************************************************************/
+
+#ifndef STATS_INCLUDED
+#define STATS_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* where the time goes; a path that converts colour and codes a block in
+   one step, as -s and -j do, counts both under STATS_CODE */
+typedef enum stats_stage {
+        STATS_READ,             /* reading and parsing the input */
+        STATS_COLOR,            /* between RGB and component video */
+        STATS_CODE,             /* transform, quantize and pack, or back */
+        STATS_WRITE,            /* writing the output */
+        STATS_STAGES
+} stats_stage;
+
+typedef enum stats_counter {
+        STATS_PIXELS,           /* pixels compressed or decompressed */
+        STATS_CODEWORDS,        /* code words written or read */
+        STATS_ALLOCATIONS,      /* heap allocations made */
+        STATS_ALLOCATED_BYTES,  /* bytes asked of the heap by them */
+        STATS_COUNTERS
+} stats_counter;
+
+/* a point in wall and CPU time, from which the next stage is charged */
+struct stats_clock {
+        uint64_t wall, cpu;     /* nanoseconds */
+};
+
+extern bool stats_enabled;
+
+void stats_enable(void);
+void stats_clock_read(struct stats_clock *clock);
+void stats_clock_charge(stats_stage stage, struct stats_clock *clock);
+void stats_clock_charge_wall(stats_stage stage, struct stats_clock *clock);
+void stats_clock_charge_cpu(stats_stage stage, struct stats_clock *clock);
+void stats_counter_add(stats_counter counter, uint64_t n);
+void stats_report(FILE *fp);
+
+/********** stats_start ********
+ *
+ * Starts timing the first of a sequence of stages
+ *
+ * Inputs:
+ *      struct stats_clock *clock: receives the time now
+ ************************/
+static inline void stats_start(struct stats_clock *clock)
+{
+        if (stats_enabled) {
+                stats_clock_read(clock);
+        }
+}
+
+/********** stats_lap ********
+ *
+ * Charges a stage with the time since clock, and restarts clock for the
+ * stage that follows
+ *
+ * Inputs:
+ *      stats_stage stage:              the stage that just finished
+ *      struct stats_clock *clock:      started by stats_start
+ ************************/
+static inline void stats_lap(stats_stage stage, struct stats_clock *clock)
+{
+        if (stats_enabled) {
+                stats_clock_charge(stage, clock);
+        }
+}
+
+/********** stats_wait_lap ********
+ *
+ * Charges a stage with the wall time since clock, and restarts clock for
+ * the stage that follows
+ *
+ * Inputs:
+ *      stats_stage stage:              the stage that just finished
+ *      struct stats_clock *clock:      started by stats_start
+ *
+ * Notes:
+ *      For a stage whose work was done by jobs that charge their own CPU
+ *      with stats_job_lap; the CPU of the thread waiting on them is not
+ *      the stage's cost, and is left out
+ ************************/
+static inline void stats_wait_lap(stats_stage stage,
+                                  struct stats_clock *clock)
+{
+        if (stats_enabled) {
+                stats_clock_charge_wall(stage, clock);
+        }
+}
+
+/********** stats_job_lap ********
+ *
+ * Charges a stage with the CPU time the calling thread has spent since
+ * clock, and restarts clock
+ *
+ * Inputs:
+ *      stats_stage stage:              the stage the job is part of
+ *      struct stats_clock *clock:      started by stats_start on the
+ *                                      same thread
+ *
+ * Notes:
+ *      Made by a job, on whatever thread runs it; its wall time is
+ *      charged by the thread that waits on it, with stats_wait_lap
+ ************************/
+static inline void stats_job_lap(stats_stage stage, struct stats_clock *clock)
+{
+        if (stats_enabled) {
+                stats_clock_charge_cpu(stage, clock);
+        }
+}
+
+/********** stats_count ********
+ *
+ * Adds to a counter
+ *
+ * Inputs:
+ *      stats_counter counter:  the counter
+ *      uint64_t n:             the amount added
+ ************************/
+static inline void stats_count(stats_counter counter, uint64_t n)
+{
+        if (stats_enabled) {
+                stats_counter_add(counter, n);
+        }
+}
+
+/********** stats_allocation ********
+ *
+ * Counts one heap allocation
+ *
+ * Inputs:
+ *      size_t nbytes: the bytes allocated
+ *
+ * Notes:
+ *      Made next to each malloc of the codec's own, and for the chunks
+ *      of every scratch
+ ************************/
+static inline void stats_allocation(size_t nbytes)
+{
+        if (stats_enabled) {
+                stats_counter_add(STATS_ALLOCATIONS, 1);
+                stats_counter_add(STATS_ALLOCATED_BYTES, nbytes);
+        }
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*******************************************************************************
+ *
+ *                                  stream.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the streaming compressor and decompressor.
+ *      Instead of reading the whole image and walking it once per step,
+ *      compress40_stream reads two rows of pixels at a time, converts,
+ *      transforms, quantizes and packs each 2x2 block in that pair of rows,
+ *      and writes the code words out before reading further.
+ *      decompress40_stream does the reverse, writing two rows of pixels
+ *      for every row of code words it reads. Peak memory is a small
+ *      multiple of one row, and the output is byte for byte the same as
+ *      compress40's and decompress40's because the streaming and array
+ *      based versions share the per pixel and per word steps in
+ *      compress.c and blockrow.c.
+ *
+ ******************************************************************************/
+
+#include "compress.h"
+#include "decompress.h"
+#include "ppmio.h"
+#include "scratch.h"
+#include "stats.h"
+#include "container.h"
+#include "stream.h"
+
+/********** compress40_stream ********
+ *
+ * Compresses a PPM image file to CS40 compressed format one row of 2x2
+ * blocks at a time
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a file holding a PPM image
+ *
+ * Expects:
+ *     The file to hold a properly formatted PPM image
+ *
+ * Notes:
+ *      Writes compressed image to stdout
+ *      An odd last row or column is trimmed, as in read_n_trim
+ *      Two rows of pixels and one row of code words are allocated from a
+ *      scratch, freed at the end
+ ************************/
+void compress40_stream(FILE *fp)
+{
+        struct stats_clock clock;
+        stats_start(&clock);
+        ppm_reader reader = ppm_reader_new(fp);
+        unsigned width = reader->width - reader->width % 2;
+        unsigned height = reader->height - reader->height % 2;
+        unsigned width_in_blocks = width / 2;
+
+        scratch s = scratch_new();
+        size_t row_bytes = reader->width * sizeof(struct rgb16);
+        struct rgb16 *top = scratch_alloc(s, row_bytes);
+        struct rgb16 *bottom = scratch_alloc(s, row_bytes);
+        uint32_t *words = scratch_alloc(s, width_in_blocks * sizeof(uint32_t));
+
+        printf("COMP40 Compressed image format 2\n%u %u\n", width, height);
+
+        for (unsigned row = 0; row < height; row += 2) {
+                ppm_read_row(reader, top);
+                ppm_read_row(reader, bottom);
+                stats_lap(STATS_READ, &clock);
+                encode_block_row(top, bottom, width_in_blocks,
+                                 reader->denominator, words);
+                stats_lap(STATS_CODE, &clock);
+                write_words(stdout, words, width_in_blocks);
+                stats_lap(STATS_WRITE, &clock);
+        }
+        stats_count(STATS_PIXELS, (uint64_t)width * height);
+        stats_count(STATS_CODEWORDS, (uint64_t)width * height / 4);
+
+        scratch_free(&s);
+        ppm_reader_free(&reader);
+}
+
+/********** write_words ********
+ *
+ * Writes code words to a file in big-endian order
+ *
+ * Inputs:
+ *      FILE *fp:               the file being written
+ *      const uint32_t *words:  the code words
+ *      unsigned count:         the number of code words
+ *
+ * Expects:
+ *      fp to be open for writing
+ *
+ * Notes:
+ *      Words are staged in a small buffer so each row costs a few fwrite
+ *      calls rather than a putchar per byte
+ ************************/
+void write_words(FILE *fp, const uint32_t *words, unsigned count)
+{
+        unsigned char bytes[1024];
+
+        while (count > 0) {
+                unsigned staged = count;
+                if (staged > sizeof(bytes) / 4) {
+                        staged = sizeof(bytes) / 4;
+                }
+                codewords_to_bytes(words, staged, bytes);
+                fwrite(bytes, 4, staged, fp);
+                words += staged;
+                count -= staged;
+        }
+}
+
+/********** decompress40_stream ********
+ *
+ * Decompresses a CS40 compressed format file to a PPM image one row of 
+ * code words at a time
+ *
+ * Inputs:
+ *      FILE *fp: pointer to a CS40 compressed format file
+ *
+ * Expects:
+ *     The file to hold a properly formatted compressed image file, in
+ *     format 2 or format 3
+ *
+ * Notes:
+ *      Writes decompressed image to stdout, flushing after every pair of
+ *      rows so a reader on the other end of a pipe can start right away
+ *      Two rows of raw samples and one row of code words are allocated
+ *      from a scratch, freed at the end
+ ************************/
+void decompress40_stream(FILE *fp)
+{
+        struct comp40_header header;
+        bool read = container_read_header(fp, &header);
+        assert(read);
+        if (header.version == 3) {
+                if (!container_decompress(fp, &header, 1, stdout)) {
+                        exit(1);
+                }
+                return;
+        }
+        unsigned width = header.width;
+        unsigned height = header.height;
+
+        unsigned width_in_blocks = width / 2;
+        unsigned height_in_blocks = height / 2;
+
+        /* both rows of raw samples live in one buffer, written at once */
+        scratch s = scratch_new();
+        size_t row_bytes = 6 * (size_t)width_in_blocks;
+        unsigned char *rows = scratch_alloc(s, 2 * row_bytes);
+        uint32_t *words = scratch_alloc(s, width_in_blocks * sizeof(uint32_t));
+
+        ppm_write_header(stdout, 2 * width_in_blocks, 2 * height_in_blocks);
+
+        struct stats_clock clock;
+        stats_start(&clock);
+        for (unsigned row = 0; row < height_in_blocks; row++) {
+                unsigned got = read_words(fp, words, width_in_blocks);
+                assert(got == width_in_blocks);
+                stats_lap(STATS_READ, &clock);
+                decode_block_row(words, width_in_blocks, rows, 
+                                 rows + row_bytes);
+                stats_lap(STATS_CODE, &clock);
+                fwrite(rows, 1, 2 * row_bytes, stdout);
+                fflush(stdout);
+                stats_lap(STATS_WRITE, &clock);
+        }
+        stats_count(STATS_PIXELS, 4 * (uint64_t)width_in_blocks *
+                                  height_in_blocks);
+        stats_count(STATS_CODEWORDS, (uint64_t)width_in_blocks *
+                                     height_in_blocks);
+
+        scratch_free(&s);
+}
+
+/********** read_words ********
+ *
+ * Reads big-endian code words from a file
+ *
+ * Inputs:
+ *      FILE *fp:               the file being read
+ *      uint32_t *words:        receives the code words
+ *      unsigned count:         the number of code words wanted
+ *
+ * Return:
+ *      the number of complete code words read, less than count only if
+ *      the file ends first
+ *
+ * Expects:
+ *      fp to be open for reading
+ ************************/
+unsigned read_words(FILE *fp, uint32_t *words, unsigned count)
+{
+        unsigned char bytes[1024];
+        unsigned done = 0;
+
+        while (done < count) {
+                unsigned want = count - done;
+                if (want > sizeof(bytes) / 4) {
+                        want = sizeof(bytes) / 4;
+                }
+                unsigned got = fread(bytes, 4, want, fp);
+                codewords_from_bytes(bytes, got, words + done);
+                done += got;
+                if (got < want) {
+                        break;
+                }
+        }
+
+        return done;
+}
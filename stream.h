@@ -0,0 +1,31 @@
+/*******************************************************************************
+ *
+ *                                  stream.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for stream.c. It declares the streaming
+ *      versions of compress40 and decompress40, which work through an image
+ *      one row of 2x2 blocks at a time instead of building arrays for the
+ *      whole image, along with the code word I/O they are made of. The per
+ *      block row steps are declared in blockrow.h, which this includes.
+ *
+ ******************************************************************************/
+
+#ifndef STREAM_INCLUDED
+#define STREAM_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pnm.h>
+#include "struct_def.h"
+#include "blockrow.h"
+
+void compress40_stream(FILE *fp);
+void write_words(FILE *fp, const uint32_t *words, unsigned count);
+void decompress40_stream(FILE *fp);
+unsigned read_words(FILE *fp, uint32_t *words, unsigned count);
+
+#endif
@@ -12,6 +12,12 @@
  *      an array that represents an image with its corresponding methods
  *      and denominator. 
  *
+ *      The arrays hold pixels in packed types no wider than their samples
+ *      need: an image being compressed has up to 16 bits per sample, and
+ *      a decompressed image always has a denominator of 255. Code words
+ *      are kept packed in 32 bits; a word_info struct is only used for
+ *      the one block being quantized or dequantized.
+ *
  ******************************************************************************/
 
 #ifndef STRUCT_DEF_INCLUDED
@@ -31,6 +37,7 @@
 #include <assert.h>
 #include <math.h>
 #include <mem.h>
+#include <stdint.h>
 
 typedef struct comp_vid {
         float y;
@@ -53,4 +60,21 @@ typedef struct word_info {
         float d;
 } *word_info;
 
+/* a pixel of an image being compressed, any denominator up to 65535 */
+typedef struct rgb16 {
+        uint16_t red;
+        uint16_t green;
+        uint16_t blue;
+} *rgb16;
+
+/* a pixel of a decompressed image, with a denominator of 255 */
+typedef struct rgb8 {
+        unsigned char red;
+        unsigned char green;
+        unsigned char blue;
+} *rgb8;
+
+/* a row of rgb8 pixels is written out as is, so they must be unpadded */
+typedef char rgb8_is_packed[sizeof(struct rgb8) == 3 ? 1 : -1];
+
 #endif
\ No newline at end of file
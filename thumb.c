@@ -0,0 +1,154 @@
+/*******************************************************************************
+ *
+ *                                  thumb.c
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file contains the thumbnail decompressor. The a field of a code
+ *      word is the average Y of its 2x2 block, and the chroma fields are
+ *      the block's average Pb and Pr, so one code word gives one pixel of
+ *      a half size image without the inverse cosine transform or the four
+ *      pixels of a full decode. Quarter and eighth size images average the
+ *      Y, Pb and Pr of squares of 2x2 and 4x4 code words before converting
+ *      to RGB once per thumbnail pixel. Format 3 is read through a
+ *      container reader, one strip at a time.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "codeword.h"
+#include "quant.h"
+#include "decompress.h"
+#include "ppmio.h"
+#include "stream.h"
+#include "container.h"
+#include "scratch.h"
+#include "stats.h"
+#include "thumb.h"
+
+/********** decompress40_thumb ********
+ *
+ * Decompresses a CS40 compressed format file to a reduced PPM image
+ *
+ * Inputs:
+ *      FILE *fp:               pointer to a CS40 compressed format file
+ *      unsigned factor:        how many times smaller, on each side, the
+ *                              thumbnail is than the image: 2, 4 or 8
+ *
+ * Expects:
+ *     The file to hold a properly formatted compressed image file, in
+ *     format 2 or format 3
+ *
+ * Notes:
+ *      Writes the thumbnail to stdout; a square of code words cut short by
+ *      the right or bottom edge of the image averages the code words it has
+ *      One row of code words, one row of sums and one row of pixels are
+ *      allocated from a scratch, freed at the end
+ *      A format 3 strip that is cut short or fails a check is reported,
+ *      and the program exits
+ *      Summing the code words is charged to decoding, and turning the
+ *      averages into pixels to colour conversion
+ ************************/
+void decompress40_thumb(FILE *fp, unsigned factor)
+{
+        assert(factor == 2 || factor == 4 || factor == 8);
+        struct stats_clock clock;
+        stats_start(&clock);
+        struct comp40_header header;
+        bool read = container_read_header(fp, &header);
+        assert(read);
+        unsigned width = header.width;
+        unsigned height = header.height;
+        container_reader reader = NULL;
+        if (header.version == 3) {
+                reader = container_reader_new(fp, &header);
+                if (reader == NULL) {
+                        exit(1);
+                }
+        }
+
+        /* each thumbnail pixel covers group by group code words */
+        unsigned group = factor / 2;
+        unsigned width_in_blocks = width / 2;
+        unsigned height_in_blocks = height / 2;
+        unsigned thumb_width = (width_in_blocks + group - 1) / group;
+        unsigned thumb_height = (height_in_blocks + group - 1) / group;
+
+        scratch s = scratch_new();
+        uint32_t *words = scratch_alloc(s, width_in_blocks *
+                                           sizeof(uint32_t));
+        float *sums = scratch_alloc(s, 3 * (size_t)thumb_width *
+                                       sizeof(float));
+        unsigned char *pixels = scratch_alloc(s, 3 * (size_t)thumb_width);
+        const struct dequant_tables *tables = dequant_tables();
+
+        ppm_write_header(stdout, thumb_width, thumb_height);
+
+        for (unsigned row = 0; row < thumb_height; row++) {
+                unsigned rows = height_in_blocks - row * group;
+                if (rows > group) {
+                        rows = group;
+                }
+
+                memset(sums, 0, 3 * (size_t)thumb_width * sizeof(float));
+                for (unsigned r = 0; r < rows; r++) {
+                        const uint32_t *row_words = words;
+                        if (reader != NULL) {
+                                row_words = container_reader_row(reader,
+                                                                 row * group +
+                                                                 r);
+                                if (row_words == NULL) {
+                                        exit(1);
+                                }
+                        } else {
+                                unsigned got = read_words(fp, words,
+                                                          width_in_blocks);
+                                assert(got == width_in_blocks);
+                        }
+                        stats_lap(STATS_READ, &clock);
+                        for (unsigned i = 0; i < width_in_blocks; i++) {
+                                float *sum = sums + 3 * (i / group);
+                                uint32_t word = row_words[i];
+                                sum[0] += tables->a[CODEWORD_GETU(A, word)];
+                                sum[1] += tables->chroma[CODEWORD_GETU(PB,
+                                                                 word)];
+                                sum[2] += tables->chroma[CODEWORD_GETU(PR,
+                                                                 word)];
+                        }
+                        stats_lap(STATS_CODE, &clock);
+                }
+
+                for (unsigned col = 0; col < thumb_width; col++) {
+                        unsigned cols = width_in_blocks - col * group;
+                        if (cols > group) {
+                                cols = group;
+                        }
+                        float count = cols * rows;
+                        const float *sum = sums + 3 * col;
+                        struct comp_vid average = { sum[0] / count,
+                                                    sum[1] / count,
+                                                    sum[2] / count };
+                        struct Pnm_rgb pixel;
+                        comp_vid_to_rgb_pixel(&average, &pixel);
+                        pixels[3 * col] = pixel.red;
+                        pixels[3 * col + 1] = pixel.green;
+                        pixels[3 * col + 2] = pixel.blue;
+                }
+                stats_lap(STATS_COLOR, &clock);
+                fwrite(pixels, 3, thumb_width, stdout);
+                stats_lap(STATS_WRITE, &clock);
+        }
+
+        stats_count(STATS_PIXELS, (uint64_t)thumb_width * thumb_height);
+        stats_count(STATS_CODEWORDS, (uint64_t)width_in_blocks *
+                                     height_in_blocks);
+        scratch_free(&s);
+        if (reader != NULL) {
+                container_reader_free(&reader);
+        }
+}
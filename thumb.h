@@ -0,0 +1,22 @@
+/*******************************************************************************
+ *
+ *                                  thumb.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This is the header file for thumb.c. It declares the thumbnail
+ *      decompressor, which makes a reduced copy of a compressed image
+ *      straight from its code words.
+ *
+ ******************************************************************************/
+
+#ifndef THUMB_INCLUDED
+#define THUMB_INCLUDED
+
+#include <stdio.h>
+
+void decompress40_thumb(FILE *fp, unsigned factor);
+
+#endif
@@ -1,72 +1,95 @@
 #line 50 "www/solutions/uarray2.nw"
 #include <stdlib.h>
+#include <string.h>
 
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
 #include "uarray2.h"
+#include "uarray2_ext.h"
+#include "uarray2_rep.h"
+#include "stats.h"
 
 #define T UArray2_T
 
-/* 
- * Element (i, j) in the world of ideas maps to
- * rows[j][i] where the square brackets stand for access
- * to a Hanson UArray_T
- */
-struct T {
-        int width, height;
-        int size;
-        UArray_T rows; /* UArray_T of 'height' UArray_Ts,
-                          each of length 'width' and size 'size' */
-};
-#line 79 "www/solutions/uarray2.nw"
-static inline UArray_T row(T a, int j)
-{
-        UArray_T *prow = UArray_at(a->rows, j);   /* Ramsey idiom */
-        return *prow;
-}
 #line 92 "www/solutions/uarray2.nw"
 static int is_ok(T a)
 {
-        return a && UArray_length(a->rows) == a->height &&
-               UArray_size(a->rows) == sizeof(UArray_T) &&
-               (a->height == 0 || (UArray_length(row(a, 0)) == a->width
-                                   && UArray_size  (row(a, 0)) == a->size));
+        return a && a->cells != NULL &&
+               a->stride % UARRAY2_ALIGNMENT == 0 &&
+               a->stride >= a->width * a->size;
 }
 #line 109 "www/solutions/uarray2.nw"
-T UArray2_new(int width, int height, int size)
+static size_t init(T array, int width, int height, int size)
 {
-        int i;  /* interates over row number */
-        T array;
-        NEW(array);
+        assert(width >= 0 && height >= 0 && size > 0);
         array->width  = width;
         array->height = height;
         array->size   = size;
-        array->rows   = UArray_new(height, sizeof(UArray_T));
-        for (i = 0; i < height; i++) {
-                UArray_T *rowp = UArray_at(array->rows, i);
-                *rowp = UArray_new(width, size);
-        }
+        array->stride = (width * size + UARRAY2_ALIGNMENT - 1) /
+                        UARRAY2_ALIGNMENT * UARRAY2_ALIGNMENT;
+        array->in_scratch = 0;
+
+        /* always allocate something so empty arrays are valid */
+        size_t bytes = (size_t)array->stride * height;
+        return bytes == 0 ? UARRAY2_ALIGNMENT : bytes;
+}
+
+T UArray2_new(int width, int height, int size)
+{
+        T array;
+        NEW(array);
+        size_t bytes = init(array, width, height, size);
+        void *cells = NULL;
+        int failed = posix_memalign(&cells, UARRAY2_ALIGNMENT, bytes);
+        assert(!failed && cells != NULL);
+        stats_allocation(sizeof(*array));
+        stats_allocation(bytes);
+        memset(cells, 0, bytes);
+        array->cells = cells;
+
+        assert(is_ok(array));
+        return array;
+}
+
+T UArray2_new_scratch(scratch s, int width, int height, int size)
+{
+        T array = scratch_alloc(s, sizeof(*array));
+        size_t bytes = init(array, width, height, size);
+        array->cells = scratch_calloc(s, 1, bytes);
+        array->in_scratch = 1;
+
         assert(is_ok(array));
         return array;
 }
 #line 131 "www/solutions/uarray2.nw"
 void UArray2_free(T *array2)
 {
-        int i;
         assert(array2 != NULL && *array2 != NULL);
-        for (i = 0; i < (*array2)->height; i++) {
-                UArray_T p = row(*array2, i);
-                UArray_free(&p);
-        }
-        UArray_free(&(*array2)->rows);
+        assert(!(*array2)->in_scratch);
+        free((*array2)->cells);
         FREE(*array2);
 }
 #line 151 "www/solutions/uarray2.nw"
 void *UArray2_at(T array2, int i, int j)
 {
         assert(array2 != NULL);
-        return UArray_at(row(array2, j), i);
+        assert(i >= 0 && i < array2->width);
+        assert(j >= 0 && j < array2->height);
+        return array2->cells + (size_t)j * array2->stride +
+               (size_t)i * array2->size;
+}
+
+void *UArray2_row(T array2, int j)
+{
+        assert(array2 != NULL);
+        assert(j >= 0 && j < array2->height);
+        return array2->cells + (size_t)j * array2->stride;
+}
+
+int UArray2_stride(T array2)
+{
+        assert(array2 != NULL);
+        return array2->stride;
 }
 #line 162 "www/solutions/uarray2.nw"
 int UArray2_height(T array2)
@@ -95,11 +118,12 @@ void UArray2_map_row_major(T array2,
         assert(array2!= NULL);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
+        int size = array2->size;
         for (int j = 0; j < h; j++) {
-                /* don't want row/UArray_at in inner loop */
-                UArray_T thisrow = row(array2, j); 
-                for (int i = 0; i < w; i++)
-                        apply(i, j, array2, UArray_at(thisrow, i), cl);
+                /* walk each row straight through memory */
+                char *elem = array2->cells + (size_t)j * array2->stride;
+                for (int i = 0; i < w; i++, elem += size)
+                        apply(i, j, array2, elem, cl);
         }
 }
 #line 211 "www/solutions/uarray2.nw"
@@ -111,7 +135,10 @@ void UArray2_map_col_major(T array2,
         assert(array2 != NULL);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
-        for (int i = 0; i < w; i++)
-                for (int j = 0; j < h; j++)
-                        apply(i, j, array2, UArray_at(row(array2, j), i), cl);
-}
\ No newline at end of file
+        int stride = array2->stride;
+        for (int i = 0; i < w; i++) {
+                char *elem = array2->cells + (size_t)i * array2->size;
+                for (int j = 0; j < h; j++, elem += stride)
+                        apply(i, j, array2, elem, cl);
+        }
+}
@@ -0,0 +1,31 @@
+/*******************************************************************************
+ *
+ *                                  uarray2_ext.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file declares the functions our UArray2_T offers beyond the
+ *      course's uarray2.h interface. A UArray2_T is stored as one buffer
+ *      of rows a fixed stride apart, so a caller can take a pointer to the
+ *      start of a row and walk its elements directly, 'size' bytes apart,
+ *      instead of calling UArray2_at for every element.
+ *
+ *      UArray2_new_scratch makes an array whose representation and cells
+ *      are taken from a scratch (see scratch.h). It is released when the
+ *      scratch is freed and must not be passed to UArray2_free.
+ *
+ ******************************************************************************/
+
+#ifndef UARRAY2_EXT_INCLUDED
+#define UARRAY2_EXT_INCLUDED
+
+#include <uarray2.h>
+#include "scratch.h"
+
+UArray2_T UArray2_new_scratch(scratch s, int width, int height, int size);
+void     *UArray2_row        (UArray2_T array2, int j);
+int       UArray2_stride     (UArray2_T array2);
+
+#endif
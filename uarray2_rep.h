@@ -0,0 +1,38 @@
+/*******************************************************************************
+ *
+ *                                  uarray2_rep.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file defines the representation of a UArray2_T. It is private
+ *      to uarray2.c and a2inline.h, which reaches into it so loops over an
+ *      array can be compiled inline; everything else should go through
+ *      uarray2.h or uarray2_ext.h.
+ *
+ ******************************************************************************/
+
+#ifndef UARRAY2_REP_INCLUDED
+#define UARRAY2_REP_INCLUDED
+
+#include <uarray2.h>
+
+/* every row starts on a cache line so whole rows can be loaded at once */
+#define UARRAY2_ALIGNMENT 64
+
+/* 
+ * Element (i, j) in the world of ideas maps to the 'size' bytes at
+ * cells + j * stride + i * size, in one contiguous allocation
+ */
+struct UArray2_T {
+        int width, height;
+        int size;
+        int stride;  /* bytes from the start of one row to the next,
+                        width * size rounded up to UARRAY2_ALIGNMENT */
+        char *cells;
+        int in_scratch;  /* made by UArray2_new_scratch, so freed with
+                            its scratch and never by UArray2_free */
+};
+
+#endif
@@ -1,80 +1,76 @@
 #line 59 "www/solutions/uarray2b.nw"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
-#include "uarray2.h"
 #include "uarray2b.h"
+#include "uarray2b_rep.h"
+#include "uarray2b_ext.h"
+#include "stats.h"
 
 #define T UArray2b_T
 
-struct T { /* represents a 2D array of cells each of size 'size' */
-        int width, height;
-        unsigned blocksize;
-        unsigned size;
-        UArray2_T blocks;
-        /*
-         * matrix of blocks, each blocksize * blocksize 
-         *
-         * matrix dimensions are width and height divided by blocksize,
-         * rounded up
-         *
-         * a block is a Uarray_T of length blocksize * blocksize 
-         * and size 'size'
-         *
-         * invariant relating cells in blocks to cells in the abstraction
-         *  described in section on coordinate transformations below
-         */
-};
-#line 94 "www/solutions/uarray2b.nw"
-#include <stdio.h>  /* include so we can print diagnostics */
-
-T UArray2b_new(int width, int height, int size, int blocksize)
+static size_t init(T array, int width, int height, int size, int blocksize)
 {
         assert(blocksize > 0);
-        T array;
-        NEW(array);
+        assert(width >= 0 && height >= 0 && size > 0);
         array->width  = width;
         array->height = height;
         array->size   = size;
         array->blocksize = blocksize;
-        array->blocks = UArray2_new((width  + blocksize - 1) / blocksize,
-                                    (height + blocksize - 1) / blocksize,
-                                    sizeof(UArray_T));
-        int xblocks = UArray2_width (array->blocks); 
-        int yblocks = UArray2_height(array->blocks);
-        for (int i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *block = UArray2_at(array->blocks, i, j);
-                        *block = UArray_new(blocksize * blocksize, size);
-                        
-#line 169 "www/solutions/uarray2b.nw"
-if (0) {
-        fprintf(stderr, "Allocated %p; put %p at %p\n",
-                (void *)*block, (void *)*(UArray_T*)UArray2_at(array->blocks, i, j),
-                UArray2_at(array->blocks, i, j));
-}
-#line 115 "www/solutions/uarray2b.nw"
-                                  }
+        array->xblocks = (width  + blocksize - 1) / blocksize;
+        array->yblocks = (height + blocksize - 1) / blocksize;
+        array->block_bytes = (size_t)blocksize * blocksize * size;
+        array->in_scratch = 0;
+
+        array->shift = -1;
+        array->mask = 0;
+        if ((blocksize & (blocksize - 1)) == 0) {
+                array->shift = 0;
+                while ((1 << array->shift) < blocksize) {
+                        array->shift++;
+                }
+                array->mask = blocksize - 1;
         }
+
+        /* always allocate at least one block so empty arrays are valid */
+        size_t nblocks = (size_t)array->xblocks * array->yblocks;
+        return (nblocks > 0 ? nblocks : 1) * array->block_bytes;
+}
+
+T UArray2b_new(int width, int height, int size, int blocksize)
+{
+        T array;
+        NEW(array);
+        size_t bytes = init(array, width, height, size, blocksize);
+        void *cells = NULL;
+        int failed = posix_memalign(&cells, UARRAY2B_ALIGNMENT, bytes);
+        assert(!failed && cells != NULL);
+        stats_allocation(sizeof(*array));
+        stats_allocation(bytes);
+        memset(cells, 0, bytes);
+        array->cells = cells;
+
+        return array;
+}
+
+T UArray2b_new_scratch(scratch s, int width, int height, int size,
+                       int blocksize)
+{
+        T array = scratch_alloc(s, sizeof(*array));
+        size_t bytes = init(array, width, height, size, blocksize);
+        array->cells = scratch_calloc(s, 1, bytes);
+        array->in_scratch = 1;
+
         return array;
 }
-#line 124 "www/solutions/uarray2b.nw"
+
 void UArray2b_free(T *array2b)
 {
-        int i;
         assert(array2b && *array2b);
-        T array = *array2b;
-        int xblocks = UArray2_width (array->blocks);
-        int yblocks = UArray2_height(array->blocks);
-        assert(UArray2_size(array->blocks) == sizeof(UArray_T));
-        for (i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *p = UArray2_at(array->blocks, i, j);
-                        UArray_free(p);
-                }
-        }
-        UArray2_free(&(*array2b)->blocks);
+        assert(!(*array2b)->in_scratch);
+        free((*array2b)->cells);
         FREE(*array2b);
 }
 #line 148 "www/solutions/uarray2b.nw"
@@ -98,11 +94,22 @@ void *UArray2b_at(T array2b, int i, int j)
         assert(i >= 0 && j >= 0);
         /* avoid unused cells */
         assert(i < array2b->width && j < array2b->height);
-        int b  = array2b->blocksize;
-        int bx = i / b;   /* block x coordinate */
-        int by = j / b;   /* block y coordinate */
-        UArray_T *blockp = UArray2_at(array2b->blocks, bx, by);
-        return UArray_at(*blockp, (i % b) * b + j % b);
+        int bx, by, cell;
+        if (array2b->shift >= 0) {
+                int shift = array2b->shift;
+                unsigned mask = array2b->mask;
+                bx = i >> shift;
+                by = j >> shift;
+                cell = ((i & mask) << shift) + (j & mask);
+        } else {
+                int b = array2b->blocksize;
+                bx = i / b;
+                by = j / b;
+                cell = (i % b) * b + j % b;
+        }
+        size_t block = (size_t)bx * array2b->yblocks + by;
+        return array2b->cells + block * array2b->block_bytes
+                              + (size_t)cell * array2b->size;
 }
 #line 222 "www/solutions/uarray2b.nw"
 void UArray2b_map(T array2b, 
@@ -114,15 +121,16 @@ void UArray2b_map(T array2b,
         int       h      = array2b->height;
         int       w      = array2b->width;
         int       b      = array2b->blocksize;
-        UArray2_T blocks = array2b->blocks;
-        int       bw     = UArray2_width(blocks);
-        int       bh     = UArray2_height(blocks);
+        int       bw     = array2b->xblocks;
+        int       bh     = array2b->yblocks;
+        int       len    = b * b;
+        unsigned  size   = array2b->size;
+        /* blocks are stored in the order they are visited, so the cells */
+        /* are walked straight through memory                            */
+        char     *elem   = array2b->cells;
 
         for (int bx = 0; bx < bw; bx++) {
                 for (int by = 0; by < bh; by++) {
-                        UArray_T *blockp = UArray2_at(blocks, bx, by);
-                        UArray_T  block  = *blockp;
-                        int       len    = UArray_length(block);
                         /* (i0, j0) correspond to upper left */
                         /* corner of block (bx, by)          */
                         int i0 = b * bx; 
@@ -132,13 +140,32 @@ void UArray2b_map(T array2b,
                                 int j = j0 + cell % b;
                                 /* measured overhead 0.5% to 1.5% */
                                 if (i < w && j < h) {
-                                        apply(i, j, array2b, 
-                                              UArray_at(block, cell), cl);
+                                        apply(i, j, array2b, elem, cl);
                                 }
+                                elem += size;
                         }
                 }
         }
 }
+void UArray2b_map_blocks(T array2b,
+                         void apply(int bcol, int brow, T array2b,
+                                    void *block, void *cl),
+                         void *cl)
+{
+        assert(array2b);
+        int       bw     = array2b->xblocks;
+        int       bh     = array2b->yblocks;
+        char     *block  = array2b->cells;
+
+        /* blocks on the right and bottom edges may hang past the array; */
+        /* their cells outside it are allocated but never used           */
+        for (int bx = 0; bx < bw; bx++) {
+                for (int by = 0; by < bh; by++) {
+                        apply(bx, by, array2b, block, cl);
+                        block += array2b->block_bytes;
+                }
+        }
+}
 #line 269 "www/solutions/uarray2b.nw"
 int UArray2b_height(T array2b)
 {
@@ -163,4 +190,5 @@ int UArray2b_blocksize(T array2b)
         return array2b->blocksize;
 }
 #line 296 "www/solutions/uarray2b.nw"
-int UArray2b_version_uses_UArray2_T = 1;
\ No newline at end of file
+/* blocks now live in one contiguous allocation rather than a UArray2_T */
+int UArray2b_version_uses_UArray2_T = 0;
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*******************************************************************************
+ *
+ *                                  uarray2b_ext.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file declares the functions our UArray2b_T offers beyond the
+ *      course's uarray2b.h interface. Every block of a UArray2b_T is one
+ *      contiguous run of blocksize * blocksize cells, so a block can be
+ *      handed to a function whole rather than one cell at a time.
+ *
+ *      UArray2b_new_scratch makes an array whose representation and cells
+ *      are taken from a scratch (see scratch.h). It is released when the
+ *      scratch is freed and must not be passed to UArray2b_free.
+ *
+ ******************************************************************************/
+
+#ifndef UARRAY2B_EXT_INCLUDED
+#define UARRAY2B_EXT_INCLUDED
+
+#include <uarray2b.h>
+#include "scratch.h"
+
+UArray2b_T UArray2b_new_scratch(scratch s, int width, int height, int size,
+                                int blocksize);
+
+/*
+ * calls apply once per block, in the order map_block_major visits them,
+ * with the block's column and row in blocks and a pointer to its first
+ * cell; cell (i, j) of the block is at index i * blocksize + j
+ */
+void UArray2b_map_blocks(UArray2b_T array2b,
+                         void apply(int bcol, int brow, UArray2b_T array2b,
+                                    void *block, void *cl),
+                         void *cl);
+
+#endif
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ *
+ *                                  uarray2b_rep.h
+ *
+ *      Assignment: arith
+ *      Authors:    Jared Lee (jalee04) and Coby Keren (jkeren01)
+ *      Date:       10/24/23
+ *
+ *      This file defines the representation of a UArray2b_T. It is private
+ *      to uarray2b.c and a2inline.h, which reaches into it so loops over an
+ *      array can be compiled inline; everything else should go through
+ *      uarray2b.h.
+ *
+ ******************************************************************************/
+
+#ifndef UARRAY2B_REP_INCLUDED
+#define UARRAY2B_REP_INCLUDED
+
+#include <stddef.h>
+#include <uarray2b.h>
+
+/* cells are aligned to a cache line so whole blocks can be loaded at once */
+#define UARRAY2B_ALIGNMENT 64
+
+struct UArray2b_T { /* represents a 2D array of cells each of size 'size' */
+        int width, height;
+        unsigned blocksize;
+        unsigned size;
+        int xblocks, yblocks;   /* width and height divided by blocksize,
+                                   rounded up */
+        int shift;              /* log2(blocksize), or -1 if blocksize is
+                                   not a power of two */
+        unsigned mask;          /* blocksize - 1 when shift >= 0 */
+        size_t block_bytes;     /* blocksize * blocksize * size */
+        char *cells;
+        int in_scratch;         /* made by UArray2b_new_scratch, so freed
+                                   with its scratch and never by
+                                   UArray2b_free */
+        /*
+         * one contiguous, aligned allocation holding every block
+         *
+         * blocks are stored in the order map_block_major visits them:
+         * block (bx, by) starts at cells + (bx * yblocks + by) * block_bytes
+         *
+         * within a block, cell (i, j) is at index 
+         * (i % blocksize) * blocksize + j % blocksize
+         */
+};
+
+#endif